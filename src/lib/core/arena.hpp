@@ -0,0 +1,162 @@
+/***********************************************************************
+ *
+ * Filename: arena.hpp
+ *
+ * Description: Block allocator that frees everything it made at once.
+ *
+ * Copyright (C) 2015 Richard Layman, rlayman2000@yahoo.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include "deps.hpp"
+
+namespace feather
+{
+
+    /*
+     * The Arena hands out memory from large blocks and never frees single
+     * objects, everything goes at once when the arena is reset or deleted.
+     * Objects that need their destructor called get it called by reset(),
+     * the newest first. The scene uses one for the node fields so clearing
+     * it doesn't have to delete them one by one.
+     * Plugins make their objects in the arena through the header so the
+     * destructors are plugin code, the arena has to be reset before the
+     * plugins are unloaded.
+     * An arena isn't locked, only one thread can use it at a time. The
+     * scene's arena is only used while holding the scene's write lock.
+     */
+    class Arena
+    {
+        public:
+            Arena(std::size_t block_size=64*1024) : m_block_size(block_size),m_head(nullptr),m_used(0),m_finalizers(nullptr),m_count(0) {};
+
+            ~Arena() {
+                reset();
+                free_blocks(m_head);
+            };
+
+            // make a new object in the arena
+            template <typename _Type, typename... _Args>
+            _Type* make(_Args&&... args) {
+                void* p = allocate(sizeof(_Type),alignof(_Type));
+                _Type* obj = new(p) _Type(std::forward<_Args>(args)...);
+                if(!std::is_trivially_destructible<_Type>::value) {
+                    Finalizer* f = static_cast<Finalizer*>(allocate(sizeof(Finalizer),alignof(Finalizer)));
+                    f->destroy = [](void* o){ static_cast<_Type*>(o)->~_Type(); };
+                    f->obj = obj;
+                    f->next = m_finalizers;
+                    m_finalizers = f;
+                }
+                m_count++;
+                return obj;
+            };
+
+            // align can be bigger than the blocks' own alignment, the address is aligned not the offset
+            void* allocate(std::size_t size, std::size_t align) {
+                std::size_t offset = (m_head) ? aligned_offset(align) : 0;
+                if(!m_head || offset + size > m_head->size) {
+                    add_block(size + align);
+                    offset = aligned_offset(align);
+                }
+                m_used = offset + size;
+                return m_head->data() + offset;
+            };
+
+            /*
+             * Destroy everything in the arena. The first block is kept so
+             * an arena that gets filled and reset over and over doesn't go
+             * back to the heap.
+             */
+            void reset() {
+                for(Finalizer* f = m_finalizers; f; f = f->next)
+                    f->destroy(f->obj);
+                m_finalizers = nullptr;
+                m_count = 0;
+
+                if(m_head) {
+                    Block* first = m_head;
+                    while(first->next)
+                        first = first->next;
+                    if(first != m_head) {
+                        Block* b = m_head;
+                        while(b->next != first)
+                            b = b->next;
+                        b->next = nullptr;
+                        free_blocks(m_head);
+                        m_head = first;
+                    }
+                }
+                m_used = 0;
+            };
+
+            // number of objects made since the last reset
+            unsigned int count() const { return m_count; };
+
+        private:
+            Arena(Arena const&);
+            Arena& operator=(Arena const&);
+
+            struct Block
+            {
+                Block* next;
+                std::size_t size; // bytes after the header
+                char* data() { return reinterpret_cast<char*>(this) + header(); };
+                static std::size_t header() { return (sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1); };
+            };
+
+            struct Finalizer
+            {
+                void (*destroy)(void*);
+                void* obj;
+                Finalizer* next;
+            };
+
+            // where the next object with the alignment goes in the head block
+            std::size_t aligned_offset(std::size_t align) {
+                const std::uintptr_t start = reinterpret_cast<std::uintptr_t>(m_head->data());
+                return ((start + m_used + align - 1) & ~(align - 1)) - start;
+            };
+
+            void add_block(std::size_t min_size) {
+                std::size_t size = std::max(m_block_size,min_size);
+                Block* b = static_cast<Block*>(::operator new(Block::header() + size));
+                b->next = m_head;
+                b->size = size;
+                m_head = b;
+                m_used = 0;
+            };
+
+            void free_blocks(Block* b) {
+                while(b) {
+                    Block* next = b->next;
+                    ::operator delete(b);
+                    b = next;
+                }
+            };
+
+            std::size_t m_block_size;
+            Block* m_head; // the block being filled, it links to the older ones
+            std::size_t m_used; // bytes used in the head block
+            Finalizer* m_finalizers; // newest first
+            unsigned int m_count;
+    };
+
+} // namespace feather
+
+#endif
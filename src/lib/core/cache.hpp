@@ -0,0 +1,143 @@
+/***********************************************************************
+ *
+ * Filename: cache.hpp
+ *
+ * Description: Keeps a node's output values for the inputs it has already seen.
+ *
+ * Copyright (C) 2015 Richard Layman, rlayman2000@yahoo.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include "deps.hpp"
+#include "types.hpp"
+#include "field.hpp"
+#include "fieldvalue.hpp"
+
+namespace feather
+{
+
+    namespace cache
+    {
+
+        /*
+         * The NodeCache is turned on per node. Before the node's do_it is called
+         * it's In fields are hashed into a key, see scenegraph::inputs_key(). Big
+         * connected inputs go in as the version of the field they pull from. If the key is in
+         * the cache the node's Out fields are set to the values that were stored
+         * for that key and the do_it is skipped. Otherwise the do_it is called and
+         * a copy of the Out fields is stored under the key.
+         * The cache holds the last `size` keys, the oldest one gets dropped first.
+         */
+        class NodeCache
+        {
+            public:
+                NodeCache(unsigned int size=1) : m_size(size),m_hits(0),m_misses(0) {};
+                ~NodeCache() { clear(); };
+
+                unsigned int size() const { return m_size; };
+                unsigned int hits() const { return m_hits; };
+                unsigned int misses() const { return m_misses; };
+
+                void resize(unsigned int size) {
+                    m_size = size;
+                    while(m_entries.size() > m_size)
+                        drop_oldest();
+                };
+
+                void reset_stats() { m_hits=0; m_misses=0; };
+
+                void clear() {
+                    while(!m_entries.empty())
+                        drop_oldest();
+                };
+
+                // a miss that couldn't be looked up
+                void miss() { m_misses++; };
+
+                // copy the stored values into the node's Out fields if the key is cached
+                bool restore(uint64_t key, field::Fields& fields) {
+                    for(auto it=m_entries.begin(); it!=m_entries.end(); ++it) {
+                        if(it->key != key)
+                            continue;
+
+                        for(field::FieldBase* v : it->values) {
+                            for(field::FieldBase* f : fields) {
+                                if(f->id == v->id) {
+                                    field::copy_value(f,v);
+                                    break;
+                                }
+                            }
+                        }
+
+                        // most recently used goes to the front
+                        m_entries.splice(m_entries.begin(),m_entries,it);
+                        m_hits++;
+                        return true;
+                    }
+                    m_misses++;
+                    return false;
+                };
+
+                // keep a copy of the node's Out field values for the key
+                void store(uint64_t key, field::Fields& fields) {
+                    if(!m_size)
+                        return;
+
+                    Entry entry;
+                    entry.key = key;
+                    for(field::FieldBase* f : fields) {
+                        if(f->conn_type != field::connection::Out)
+                            continue;
+                        field::FieldBase* v = field::clone_field(f);
+                        if(v)
+                            entry.values.push_back(v);
+                    }
+
+                    m_entries.push_front(entry);
+                    while(m_entries.size() > m_size)
+                        drop_oldest();
+                };
+
+            private:
+                NodeCache(NodeCache const&);
+                NodeCache& operator=(NodeCache const&);
+
+                struct Entry
+                {
+                    uint64_t key;
+                    field::Fields values;
+                };
+
+                void drop_oldest() {
+                    for(field::FieldBase* v : m_entries.back().values)
+                        field::delete_field(v);
+                    m_entries.pop_back();
+                };
+
+                std::list<Entry> m_entries; // most recently used first
+                unsigned int m_size;
+                unsigned int m_hits;
+                unsigned int m_misses;
+        };
+
+    } // namespace cache
+
+} // namespace feather
+
+#endif
@@ -34,18 +34,34 @@
 
 // C++
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
+#include <deque>
+#include <list>
 #include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <iomanip>
 #include <cstdlib>
 #include <algorithm>
+#include <numeric>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
 #include <utility>
 #include <chrono>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <atomic>
 
 // OpenGL
 #include <GL/gl.h>
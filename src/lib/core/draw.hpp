@@ -61,7 +61,13 @@ namespace feather {
             unsigned int fovfid;
         };
 
-        typedef std::vector<Item*> DrawItems;
+        /*
+         * The items are made by the node's plugin and belong to whoever
+         * asked for them, the viewports keep them for as long as they
+         * draw the node. They have to be dropped before the plugins are
+         * unloaded.
+         */
+        typedef std::vector<std::shared_ptr<Item> > DrawItems;
 
     } // namespace draw
 
@@ -71,12 +77,12 @@ namespace feather {
     template <> status node_draw_it<__node_enum>(draw::DrawItems& items)
 
 #define ADD_LINE(__startpoint,__endpoint,__color,__type)\
-    items.push_back(new draw::Line(__startpoint,__endpoint,__color,__type));
+    items.push_back(std::shared_ptr<draw::Item>(new draw::Line(__startpoint,__endpoint,__color,__type)));
  
 #define ADD_MESH(__fid)\
-    items.push_back(new draw::Mesh(__fid));
+    items.push_back(std::shared_ptr<draw::Item>(new draw::Mesh(__fid)));
  
 #define ADD_PERSP_CAMERA(__fovfid)\
-    items.push_back(new draw::PerspCamera(__fovfid));
+    items.push_back(std::shared_ptr<draw::Item>(new draw::PerspCamera(__fovfid)));
     
 #endif
@@ -0,0 +1,207 @@
+/***********************************************************************
+ *
+ * Filename: events.hpp
+ *
+ * Description: Tells the widgets which fields and nodes changed.
+ *
+ * Copyright (C) 2015 Richard Layman, rlayman2000@yahoo.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+
+#ifndef EVENTS_HPP
+#define EVENTS_HPP
+
+#include "deps.hpp"
+
+namespace feather
+{
+
+    namespace event
+    {
+
+        enum Kind {
+            NodeAdded,
+            NodeRemoved,
+            Connected,
+            Disconnected,
+            Renamed,
+            Cleared // uid is 0, everything before it was dropped
+        };
+
+        // a field's value was written
+        struct FieldEvent
+        {
+            FieldEvent(unsigned int _uid=0, unsigned int _fid=0, uint64_t _version=0) : uid(_uid),fid(_fid),version(_version) {};
+            unsigned int uid;
+            unsigned int fid;
+            uint64_t version; // the field's version after the write
+        };
+
+        // a node was added, removed, connected...
+        struct TopologyEvent
+        {
+            TopologyEvent(unsigned int _uid=0, Kind _kind=NodeAdded) : uid(_uid),kind(_kind) {};
+            unsigned int uid;
+            Kind kind;
+        };
+
+        typedef std::vector<FieldEvent> FieldEvents;
+        typedef std::vector<TopologyEvent> TopologyEvents;
+
+        // the events a subscriber wants, -1 matches any uid or fid
+        struct Filter
+        {
+            Filter(bool _fields=true, bool _topology=true, int _uid=-1, int _fid=-1) : fields(_fields),topology(_topology),uid(_uid),fid(_fid) {};
+            bool fields;
+            bool topology;
+            int uid;
+            int fid;
+
+            bool match(const FieldEvent& e) const { return fields && (uid < 0 || e.uid==static_cast<unsigned int>(uid)) && (fid < 0 || e.fid==static_cast<unsigned int>(fid)); };
+            bool match(const TopologyEvent& e) const { return topology && (uid < 0 || e.uid==static_cast<unsigned int>(uid) || e.kind==Cleared); };
+        };
+
+        typedef std::function<void(const FieldEvents&, const TopologyEvents&)> Handler;
+
+        /*
+         * The EventBus collects what changed in the scene so the widgets can
+         * refresh only that instead of rebuilding everything. The scene
+         * publishes an event for each field write and topology change and
+         * they are held until flush(), which the widgets call once a frame.
+         * A field written many times in a frame is only sent once with it's
+         * latest version. Topology changes keep their order, a change is only
+         * dropped when it repeats the last one queued for the same node, so
+         * a node added, removed and added again is sent as all three.
+         * Each subscriber gets the events that match it's filter, in one
+         * call per flush, and nothing if none of them match.
+         * Events can be published from the update threads, flush() and the
+         * subscribing are done by the thread that owns the scene.
+         */
+        class EventBus
+        {
+            public:
+                EventBus() : m_next_id(1),m_count(0) {};
+
+                // returns the id to unsubscribe with
+                unsigned int subscribe(const Filter& filter, Handler handler) {
+                    m_subscribers.push_back(Subscriber(m_next_id,filter,handler));
+                    m_count = m_subscribers.size();
+                    return m_next_id++;
+                };
+
+                void unsubscribe(unsigned int id) {
+                    m_subscribers.erase(std::remove_if(m_subscribers.begin(),m_subscribers.end(),[id](const Subscriber& s){ return s.id==id; }),m_subscribers.end());
+                    m_count = m_subscribers.size();
+                };
+
+                // nothing is queued when no one is subscribed, safe to call from the update threads
+                bool listening() const { return m_count > 0; };
+
+                void field_changed(unsigned int uid, unsigned int fid, uint64_t version) {
+                    if(!listening())
+                        return;
+                    std::lock_guard<std::mutex> guard(m_mutex);
+                    const uint64_t key = (static_cast<uint64_t>(uid) << 32) | fid;
+                    auto i = m_field_index.find(key);
+                    if(i == m_field_index.end()) {
+                        m_field_index[key] = m_fields.size();
+                        m_fields.push_back(FieldEvent(uid,fid,version));
+                    } else
+                        m_fields[i->second].version = std::max(m_fields[i->second].version,version);
+                };
+
+                void topology_changed(unsigned int uid, Kind kind) {
+                    if(!listening())
+                        return;
+                    std::lock_guard<std::mutex> guard(m_mutex);
+                    if(kind==Cleared) {
+                        // the events of the cleared nodes don't mean anything now
+                        m_fields.clear();
+                        m_field_index.clear();
+                        m_topology.clear();
+                        m_topology_last.clear();
+                    }
+                    auto i = m_topology_last.find(uid);
+                    if(i != m_topology_last.end() && m_topology[i->second].kind==kind)
+                        return;
+                    m_topology_last[uid] = m_topology.size();
+                    m_topology.push_back(TopologyEvent(uid,kind));
+                };
+
+                bool pending() {
+                    std::lock_guard<std::mutex> guard(m_mutex);
+                    return !m_fields.empty() || !m_topology.empty();
+                };
+
+                // send the events collected since the last flush
+                void flush() {
+                    FieldEvents fields;
+                    TopologyEvents topology;
+                    {
+                        std::lock_guard<std::mutex> guard(m_mutex);
+                        fields.swap(m_fields);
+                        topology.swap(m_topology);
+                        m_field_index.clear();
+                        m_topology_last.clear();
+                    }
+                    if(fields.empty() && topology.empty())
+                        return;
+
+                    // a handler can subscribe or unsubscribe, so go through a copy
+                    std::vector<Subscriber> subscribers = m_subscribers;
+                    FieldEvents f;
+                    TopologyEvents t;
+                    for(const Subscriber& s : subscribers) {
+                        f.clear();
+                        t.clear();
+                        for(const FieldEvent& e : fields) {
+                            if(s.filter.match(e))
+                                f.push_back(e);
+                        }
+                        for(const TopologyEvent& e : topology) {
+                            if(s.filter.match(e))
+                                t.push_back(e);
+                        }
+                        if(!f.empty() || !t.empty())
+                            s.handler(f,t);
+                    }
+                };
+
+            private:
+                struct Subscriber
+                {
+                    Subscriber(unsigned int _id, const Filter& _filter, Handler _handler) : id(_id),filter(_filter),handler(_handler) {};
+                    unsigned int id;
+                    Filter filter;
+                    Handler handler;
+                };
+
+                std::vector<Subscriber> m_subscribers;
+                unsigned int m_next_id;
+                std::atomic<unsigned int> m_count; // size of m_subscribers for listening()
+                std::mutex m_mutex;
+                FieldEvents m_fields;
+                std::unordered_map<uint64_t,unsigned int> m_field_index; // where each field's event is in m_fields
+                TopologyEvents m_topology;
+                std::unordered_map<unsigned int,unsigned int> m_topology_last; // where each node's last event is in m_topology
+        };
+
+    } // namespace event
+
+} // namespace feather
+
+#endif
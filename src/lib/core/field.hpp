@@ -65,7 +65,7 @@ namespace feather
         // The puid will change when nodes are removed, so it's need's to be updated
         struct FieldBase
         {
-            FieldBase():update(true),connected(false),puid(0),pf(0),type(0){};
+            FieldBase():update(true),connected(false),puid(0),pf(0),type(0),version(0){};
             int id;
             bool update; // this is used to optimize the scenegraph update process - the sg won't call a node's do_it unless one of it's input's fields update flags are set to true.
             // Connections
@@ -76,6 +76,7 @@ namespace feather
             int pn; // node key of the connected field
             int pf; // field key of connected node
             int type;
+            uint64_t version; // scene version of the last write to the value, 0 if it was never written
         };
 
         //template <typename _Type, int _Conn>
@@ -92,87 +93,119 @@ namespace feather
 
         typedef std::vector<FieldBase*> Fields;
 
+        /*
+         * Where each fid is in the Fields of a node type, -1 if the type has
+         * no such field. Every node of a type has it's fields in the same
+         * order, so the table is made once when the plugin is loaded.
+         */
+        typedef std::vector<int> FieldSlots;
 
-        // CHECK CONNECTION
+        // the table of the fields that were made for a node
+        inline FieldSlots field_slots(const Fields& fields)
+        {
+            FieldSlots slots;
+            for(unsigned int i=0; i < fields.size(); i++) {
+                const int fid = fields[i]->id;
+                if(slots.size() <= static_cast<unsigned int>(fid))
+                    slots.resize(fid+1,-1);
+                slots[fid] = i;
+            }
+            return slots;
+        };
 
 
-        template <int _Type1, int _Type2>
-        static bool can_connect() { return false; };
-
-        // NOTE!!!!
-        // THIS IS INCOMPLETE!!!!
-        // I need to add all the instances for each type.
-        // Currently this is just a brief list for testing.
-        template <> bool can_connect<Bool,Bool>() { return true; };
-        template <> bool can_connect<Int,Int>() { return true; };
-        template <> bool can_connect<Double,Double>() { return true; };
-        template <> bool can_connect<Float,Float>() { return true; };
-        template <> bool can_connect<Real,Real>() { return true; };
-        template <> bool can_connect<Mesh,Mesh>() { return true; };
-        template <> bool can_connect<Node,Node>() { return true; };
-        template <> bool can_connect<Time,Time>() { return true; };
-       
-        template <int _Type1, int _Type2>
-        struct can_types_connect {
-            static bool exec(int t1, int t2) {
-                if(t1==_Type1 && t2==_Type2)
-                    return can_connect<_Type1,_Type2>();
-                else {
-                    if(t2==_Type2) 
-                        return can_types_connect<_Type1-1,_Type2>::exec(t1,t2);
-                    else
-                        return can_types_connect<_Type1,_Type2-1>::exec(t1,t2);
-                }
+        // CHECK CONNECTION
+
+        namespace conversion
+        {
+            enum Kind {
+                None=0, // the types can't be connected
+                Same=1, // the source value is copied into the input's field before the node runs
+                Convert=2 // the source value is converted into the input's field before the node runs
             };
+        } // namespace conversion
+
+        // how each source type connects to each target type, the source type is the first index
+        struct ConnectionTable
+        {
+            unsigned char kind[START][START];
         };
-   
-        template <int _Type> struct can_types_connect<_Type,N> {
-            static bool exec(int t1, int t2) { return false; };
+
+        /*
+         * Every type connects to itself. The implicit conversions only go
+         * the way that doesn't lose anything, and arrays widen the same as
+         * their items do. Each Convert entry needs a kernel in the
+         * converter table, see fieldvalue.hpp.
+         */
+        constexpr ConnectionTable make_connection_table()
+        {
+            ConnectionTable t{};
+            for(int i=Bool; i < START; i++)
+                t.kind[i][i] = conversion::Same;
+
+            t.kind[Bool][Int] = conversion::Convert;
+            t.kind[Int][Float] = conversion::Convert;
+            t.kind[Int][Double] = conversion::Convert;
+            t.kind[Int][Real] = conversion::Convert;
+            t.kind[Float][Double] = conversion::Convert;
+            t.kind[Float][Real] = conversion::Convert;
+            t.kind[Double][Real] = conversion::Convert;
+            t.kind[Real][Double] = conversion::Convert;
+            t.kind[Vertex][Vector] = conversion::Convert;
+            t.kind[RGB][RGBA] = conversion::Convert;
+
+            t.kind[BoolArray][IntArray] = conversion::Convert;
+            t.kind[IntArray][FloatArray] = conversion::Convert;
+            t.kind[VertexArray][VectorArray] = conversion::Convert;
+            t.kind[RGBArray][RGBAArray] = conversion::Convert;
+            return t;
         };
- 
-        template <int _Type> struct can_types_connect<N,_Type> {
-            static bool exec(int t1, int t2) { return false; };
+
+        constexpr ConnectionTable connection_table = make_connection_table();
+
+        // how a field of type t1 connects to an input of type t2, this is one load from the table
+        constexpr conversion::Kind connection_kind(int t1, int t2)
+        {
+            return (static_cast<unsigned int>(t1) < START && static_cast<unsigned int>(t2) < START) ?
+                static_cast<conversion::Kind>(connection_table.kind[t1][t2]) : conversion::None;
         };
 
+        constexpr bool can_types_connect(int t1, int t2) { return connection_kind(t1,t2) != conversion::None; };
+
+        template <int _Type1, int _Type2>
+        constexpr bool can_connect() { return can_types_connect(_Type1,_Type2); };
+
+        static_assert(can_connect<Int,Int>() && can_connect<Int,Float>() && !can_connect<Float,Int>() && !can_connect<N,N>(), "bad connection table");
+
+        /*
+         * Puts the value of src, a field of the connection's source type,
+         * into dst, the input it's connected to. For a Same connection it's
+         * a copy.
+         */
+        typedef void (*Converter)(const FieldBase* src, FieldBase* dst);
+
     } // namespace field
 
 #define ADD_FIELD_TO_NODE(__node,__type,__type_enum,__connection,__default_value,__field_key)\
     namespace feather {\
+        template <> struct field_type<__node,__field_key> { typedef __type type; };\
+\
         template <> struct add_fields<__node,__field_key> {\
-            static status exec(field::Fields& fields) {\
-                 field::Field<__type>* f = new field::Field<__type>();\
+            static status exec(field::Fields& fields, field::FieldStore& store) {\
+                 field::Field<__type>* f = store.make<field::Field<__type> >(__node,__field_key);\
                 f->id=__field_key;\
                 f->value=__default_value;\
                 f->type=__type_enum;\
                 f->conn_type=__connection;\
                 fields.push_back(f);\
-                return add_fields<__node,__field_key-1>::exec(fields);\
+                return add_fields<__node,__field_key-1>::exec(fields,store);\
             };\
         };\
 \
         template <> field::FieldBase* field_data<__node,__field_key>(field::Fields& fields)\
         {\
-            /*This is a cheap easy way to get FieldBase*\
-            But it's needs to be changed later so we\
-            don't have to scan the field every time\
-            to get the pointer.*/\
-            for(uint i=0; i < fields.size(); i++) {\
-                if(fields.at(i)->id == __field_key){\
-                    return fields.at(i);\
-                }\
-            }\
-            /*std::cout << "never found matching key in field_data\n";*/\
-            return NULL;\
-        };\
- \
-        template <> struct find_field<__node,__field_key> {\
-            static field::FieldBase* exec(int fid, field::Fields& fields) {\
-                /*std::cout << "find field - node:" << __node << ", fid:" << fid << ", field:" << __field_key << std::endl;*/\
-                if(fid==__field_key){\
-                    return field_data<__node,__field_key>(fields);\
-                }else\
-                    return find_field<__node,__field_key-1>::exec(fid,fields);\
-            };\
+            /*the slot comes from the table made when the plugin was loaded*/\
+            return plugin_field(__node,__field_key,fields);\
         };\
     }
 
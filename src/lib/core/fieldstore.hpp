@@ -0,0 +1,232 @@
+/***********************************************************************
+ *
+ * Filename: fieldstore.hpp
+ *
+ * Description: Keeps the fields of all the nodes of a type together in columns.
+ *
+ * Copyright (C) 2015 Richard Layman, rlayman2000@yahoo.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef FIELDSTORE_HPP
+#define FIELDSTORE_HPP
+
+#include "deps.hpp"
+#include "field.hpp"
+#include "arena.hpp"
+
+namespace feather
+{
+
+    namespace field
+    {
+
+        // rows in each chunk of a column
+        static const unsigned int COLUMN_CHUNK_ROWS = 256;
+
+        // the fields of some rows of a column, they never move once made
+        template <typename _Field>
+        struct ColumnChunk
+        {
+            ColumnChunk() : count(0) {};
+            ~ColumnChunk() {
+                for(unsigned int i=0; i < count; i++)
+                    at(i)->~_Field();
+            };
+            _Field* at(unsigned int i) { return reinterpret_cast<_Field*>(&data[i]); };
+            typename std::aligned_storage<sizeof(_Field),alignof(_Field)>::type data[COLUMN_CHUNK_ROWS];
+            unsigned int count; // rows that have been made
+        };
+
+        // one fid of one node type
+        struct ColumnData
+        {
+            ColumnData() : type(nullptr),rows(0) {};
+            const std::type_info* type; // the column's field type
+            std::vector<void*> chunks;
+            unsigned int rows; // rows that have been made
+        };
+
+        /*
+         * Typed view of a column. Row r of the column is the field of the
+         * node that has row r, see FieldStore::uid(). Rows of removed nodes
+         * stay in the column until the row is used by a new node, check
+         * uid() if they need to be skipped.
+         * The rows are stored in chunks of COLUMN_CHUNK_ROWS fields, walking
+         * the chunks is the fast way to go through the whole column.
+         */
+        template <typename _Field>
+        class Column
+        {
+            public:
+                Column(ColumnData* data=nullptr, const std::vector<int>* uids=nullptr) : m_data(data),m_uids(uids) {};
+
+                unsigned int rows() const { return (m_data) ? m_data->rows : 0; };
+
+                // uid of the node using the row, -1 if the row is free
+                int uid(unsigned int row) const { return (m_uids && row < m_uids->size()) ? (*m_uids)[row] : -1; };
+
+                _Field& operator[](unsigned int row) const { return chunk(row/COLUMN_CHUNK_ROWS)[row%COLUMN_CHUNK_ROWS]; };
+
+                unsigned int chunk_count() const { return (m_data) ? m_data->chunks.size() : 0; };
+
+                _Field* chunk(unsigned int i) const { return static_cast<ColumnChunk<_Field>*>(m_data->chunks[i])->at(0); };
+
+                unsigned int chunk_rows(unsigned int i) const { return static_cast<ColumnChunk<_Field>*>(m_data->chunks[i])->count; };
+
+            private:
+                ColumnData* m_data;
+                const std::vector<int>* m_uids;
+        };
+
+        /*
+         * The FieldStore makes the node fields of a scene. Every node gets a
+         * row in the store for it's node type and each of the node's fields
+         * goes in the column of it's fid at that row, so the same field of
+         * all the nodes of a type is next to each other in memory.
+         * The node's Fields still point to it's fields, which don't move, so
+         * code that works on one node doesn't need to know about the store.
+         * The columns live in the scene's arena and are freed when the arena
+         * is reset, the store has to be cleared at the same time.
+         * The rows of removed nodes get reused by new nodes of the same type.
+         */
+        class FieldStore
+        {
+            public:
+                FieldStore(Arena& arena) : m_arena(arena) {};
+
+                /*
+                 * Get a row for a new node of the nid, the fields made after
+                 * this for the nid go in this row.
+                 */
+                unsigned int add_row(int nid, int uid) {
+                    TypeRows& t = type_rows(nid);
+                    if(!t.free_rows.empty()) {
+                        t.current = t.free_rows.back();
+                        t.free_rows.pop_back();
+                    } else {
+                        t.current = t.uids.size();
+                        t.uids.push_back(-1);
+                    }
+                    t.uids[t.current] = uid;
+                    return t.current;
+                };
+
+                // the row's fields get replaced when the row is used again
+                void free_row(int nid, unsigned int row) {
+                    TypeRows* t = find(nid);
+                    if(!t || row >= t->uids.size() || t->uids[row] < 0)
+                        return;
+                    t->uids[row] = -1;
+                    t->free_rows.push_back(row);
+                };
+
+                // make the field for the fid in the nid's current row, this is called by ADD_FIELD_TO_NODE
+                template <typename _Field>
+                _Field* make(int nid, int fid) {
+                    TypeRows& t = type_rows(nid);
+                    if(t.uids.empty())
+                        add_row(nid,-1);
+                    ColumnData& c = column_data(t,fid);
+                    if(!c.type)
+                        c.type = &typeid(_Field);
+
+                    const unsigned int row = t.current;
+                    while(c.chunks.size() <= row/COLUMN_CHUNK_ROWS)
+                        c.chunks.push_back(m_arena.make<ColumnChunk<_Field> >());
+                    ColumnChunk<_Field>* chunk = static_cast<ColumnChunk<_Field>*>(c.chunks[row/COLUMN_CHUNK_ROWS]);
+                    const unsigned int i = row%COLUMN_CHUNK_ROWS;
+
+                    // the rows in a chunk are made in order
+                    if(i < chunk->count)
+                        chunk->at(i)->~_Field();
+                    while(chunk->count < i)
+                        new(chunk->at(chunk->count++)) _Field();
+                    _Field* f = new(chunk->at(i)) _Field();
+                    if(i == chunk->count)
+                        chunk->count++;
+                    c.rows = std::max(c.rows,row+1);
+                    return f;
+                };
+
+                // an empty column if there is no column or it's type isn't _Field
+                template <typename _Field>
+                Column<_Field> column(int nid, int fid) {
+                    TypeRows* t = find(nid);
+                    if(!t || fid < 0 || static_cast<unsigned int>(fid) >= t->columns.size())
+                        return Column<_Field>();
+                    ColumnData* c = t->columns[fid];
+                    // compared by value, the plugins have their own copy of the type_info
+                    if(!c || !c->type || *c->type != typeid(_Field))
+                        return Column<_Field>();
+                    return Column<_Field>(c,&t->uids);
+                };
+
+                // uid of the node using the row, -1 if the row is free
+                int uid(int nid, unsigned int row) const {
+                    const TypeRows* t = find(nid);
+                    if(!t || row >= t->uids.size())
+                        return -1;
+                    return t->uids[row];
+                };
+
+                // forget all the rows, the arena frees the columns
+                void clear() { m_types.clear(); };
+
+            private:
+                FieldStore(FieldStore const&);
+                FieldStore& operator=(FieldStore const&);
+
+                struct TypeRows
+                {
+                    TypeRows() : current(0) {};
+                    std::vector<ColumnData*> columns; // by fid, null if the type has no such field
+                    std::vector<int> uids; // node of each row, -1 if the row is free
+                    std::vector<unsigned int> free_rows;
+                    unsigned int current; // row new fields go in
+                };
+
+                TypeRows* find(int nid) const {
+                    if(nid < 0 || static_cast<unsigned int>(nid) >= m_types.size())
+                        return nullptr;
+                    return m_types[nid];
+                };
+
+                TypeRows& type_rows(int nid) {
+                    if(m_types.size() <= static_cast<unsigned int>(nid))
+                        m_types.resize(nid+1,nullptr);
+                    if(!m_types[nid])
+                        m_types[nid] = m_arena.make<TypeRows>();
+                    return *m_types[nid];
+                };
+
+                ColumnData& column_data(TypeRows& t, int fid) {
+                    if(t.columns.size() <= static_cast<unsigned int>(fid))
+                        t.columns.resize(fid+1,nullptr);
+                    if(!t.columns[fid])
+                        t.columns[fid] = m_arena.make<ColumnData>();
+                    return *t.columns[fid];
+                };
+
+                Arena& m_arena;
+                std::vector<TypeRows*> m_types; // by nid, the rows are in the arena
+        };
+
+    } // namespace field
+
+} // namespace feather
+
+#endif
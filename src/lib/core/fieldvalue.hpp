@@ -0,0 +1,287 @@
+/***********************************************************************
+ *
+ * Filename: fieldvalue.hpp
+ *
+ * Description: Works on field values without knowing their type at compile time.
+ *
+ * Copyright (C) 2015 Richard Layman, rlayman2000@yahoo.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef FIELDVALUE_HPP
+#define FIELDVALUE_HPP
+
+#include "deps.hpp"
+#include "types.hpp"
+#include "field.hpp"
+
+namespace feather
+{
+
+    namespace field
+    {
+
+        /*
+         * The scenegraph only sees a FieldBase* and the field's type enum.
+         * with_value_type() calls fn with a type_tag of the C++ type that
+         * the field::Type holds, so fn can cast the field to it's Field<T>.
+         * Node fields don't hold a value and return false.
+         */
+        template <typename _Type>
+        struct type_tag { typedef _Type type; };
+
+        template <typename _Fn>
+        bool with_value_type(int type, _Fn fn)
+        {
+            switch(type)
+            {
+                case Bool: fn(type_tag<FBool>()); return true;
+                case Int: fn(type_tag<FInt>()); return true;
+                case Float: fn(type_tag<FFloat>()); return true;
+                case Double: fn(type_tag<FDouble>()); return true;
+                case Real: fn(type_tag<FReal>()); return true;
+                case Vertex: fn(type_tag<FVertex3D>()); return true;
+                case Vector: fn(type_tag<FVector3D>()); return true;
+                case Mesh: fn(type_tag<FMesh>()); return true;
+                case RGB: fn(type_tag<FColorRGB>()); return true;
+                case RGBA: fn(type_tag<FColorRGBA>()); return true;
+                case BoolArray: fn(type_tag<FBoolArray>()); return true;
+                case IntArray: fn(type_tag<FIntArray>()); return true;
+                case FloatArray: fn(type_tag<FFloatArray>()); return true;
+                case VertexArray: fn(type_tag<FVertex3DArray>()); return true;
+                case VectorArray: fn(type_tag<FVectorArray>()); return true;
+                case RGBArray: fn(type_tag<FColorRGBArray>()); return true;
+                case RGBAArray: fn(type_tag<FColorRGBAArray>()); return true;
+                case Time: fn(type_tag<FTime>()); return true;
+                default: return false;
+            }
+        };
+
+
+        // HASH
+
+        // FNV-1a
+        inline void hash_bytes(const void* data, std::size_t size, uint64_t& h)
+        {
+            const unsigned char* p = static_cast<const unsigned char*>(data);
+            for(std::size_t i=0; i < size; i++) {
+                h ^= p[i];
+                h *= 1099511628211ULL;
+            }
+        };
+
+        template <typename _Type>
+        void hash_value(const _Type& val, uint64_t& h) { hash_bytes(&val,sizeof(_Type),h); };
+
+        inline void hash_value(const FString& val, uint64_t& h) { hash_bytes(val.data(),val.size(),h); };
+
+        template <typename _Type, typename _Alloc>
+        void hash_value(const std::vector<_Type,_Alloc>& val, uint64_t& h) {
+            std::size_t size = val.size();
+            hash_value(size,h);
+            for(const _Type& v : val)
+                hash_value(v,h);
+        };
+
+        inline void hash_value(const FMesh& val, uint64_t& h) {
+            hash_value(val.v.read(),h);
+            hash_value(val.st.read(),h);
+            hash_value(val.vn.read(),h);
+            hash_value(val.f.read(),h);
+        };
+
+        // types with a small fixed size value that's cheap to hash
+        inline bool is_scalar(int type)
+        {
+            return (type >= Bool && type <= Vector) || type == RGB || type == RGBA || type == Time;
+        };
+
+        /*
+         * Adds the field's value to the hash.
+         * Node fields don't hold a value so what they are connected to is used.
+         * Returns false if the field's value can't be hashed.
+         */
+        inline bool hash_field(FieldBase* f, uint64_t& h)
+        {
+            if(f->type == Node) {
+                hash_value(f->connected,h);
+                hash_value(f->puid,h);
+                hash_value(f->pf,h);
+                return true;
+            }
+            return with_value_type(f->type,[f,&h](auto tag){
+                    typedef typename decltype(tag)::type T;
+                    hash_value(static_cast<Field<T>*>(f)->value,h);
+                    });
+        };
+
+
+        // COPY
+
+        // copies the value of src into dst, both fields need to be the same type
+        inline bool copy_value(FieldBase* dst, FieldBase* src)
+        {
+            if(dst->type != src->type)
+                return false;
+            return with_value_type(src->type,[dst,src](auto tag){
+                    typedef typename decltype(tag)::type T;
+                    static_cast<Field<T>*>(dst)->value = static_cast<Field<T>*>(src)->value;
+                    });
+        };
+
+        // returns a new field with the same value and connection state or null
+        inline FieldBase* clone_field(FieldBase* src)
+        {
+            FieldBase* f = nullptr;
+            with_value_type(src->type,[src,&f](auto tag){
+                    typedef typename decltype(tag)::type T;
+                    f = new Field<T>(*static_cast<Field<T>*>(src));
+                    });
+            return f;
+        };
+
+        // deletes a field made by clone_field()
+        inline void delete_field(FieldBase* f)
+        {
+            with_value_type(f->type,[f](auto tag){
+                    typedef typename decltype(tag)::type T;
+                    delete static_cast<Field<T>*>(f);
+                    });
+        };
+
+
+        // CONVERT
+
+        template <typename _From, typename _To>
+        void convert_value(const _From& src, _To& dst) { dst = static_cast<_To>(src); };
+
+        inline void convert_value(const FVertex3D& src, FVector3D& dst) {
+            dst.x = src.x;
+            dst.y = src.y;
+            dst.z = src.z;
+            dst.w = 0;
+        };
+
+        inline void convert_value(const FColorRGB& src, FColorRGBA& dst) {
+            dst.r = src.r;
+            dst.g = src.g;
+            dst.b = src.b;
+            dst.a = 1.0;
+        };
+
+        template <typename _From, typename _FromAlloc, typename _To, typename _ToAlloc>
+        void convert_value(const std::vector<_From,_FromAlloc>& src, std::vector<_To,_ToAlloc>& dst) {
+            dst.resize(src.size());
+            for(std::size_t i=0; i < src.size(); i++)
+                convert_value(src[i],dst[i]);
+        };
+
+        inline void convert_value(const FBoolArray& src, FIntArray& dst) {
+            dst.assign(src.begin(),src.end());
+        };
+
+        // the kernel of a conversion, the converted value has the version of the source value
+        template <typename _From, typename _To>
+        void convert_field(const FieldBase* src, FieldBase* dst) {
+            convert_value(static_cast<const Field<_From>*>(src)->value,static_cast<Field<_To>*>(dst)->value);
+            dst->version = src->version;
+        };
+
+        // the kernel of a Same connection, the arrays of an FMesh are shared until one side writes
+        template <typename _Type>
+        void copy_field(const FieldBase* src, FieldBase* dst) {
+            static_cast<Field<_Type>*>(dst)->value = static_cast<const Field<_Type>*>(src)->value;
+            dst->version = src->version;
+        };
+
+        struct ConverterTable
+        {
+            Converter kernel[START][START];
+        };
+
+        // types whose fields hold a value that can be passed along a connection
+        constexpr bool has_value(int t) { return t > N && t < START && t != Node; };
+
+        // the kernel of each entry of the connection table for the types with a value
+        constexpr ConverterTable make_converter_table()
+        {
+            ConverterTable t{};
+            t.kernel[Bool][Bool] = &copy_field<FBool>;
+            t.kernel[Int][Int] = &copy_field<FInt>;
+            t.kernel[Float][Float] = &copy_field<FFloat>;
+            t.kernel[Double][Double] = &copy_field<FDouble>;
+            t.kernel[Real][Real] = &copy_field<FReal>;
+            t.kernel[Vertex][Vertex] = &copy_field<FVertex3D>;
+            t.kernel[Vector][Vector] = &copy_field<FVector3D>;
+            t.kernel[Mesh][Mesh] = &copy_field<FMesh>;
+            t.kernel[RGB][RGB] = &copy_field<FColorRGB>;
+            t.kernel[RGBA][RGBA] = &copy_field<FColorRGBA>;
+            t.kernel[BoolArray][BoolArray] = &copy_field<FBoolArray>;
+            t.kernel[IntArray][IntArray] = &copy_field<FIntArray>;
+            t.kernel[FloatArray][FloatArray] = &copy_field<FFloatArray>;
+            t.kernel[VertexArray][VertexArray] = &copy_field<FVertex3DArray>;
+            t.kernel[VectorArray][VectorArray] = &copy_field<FVectorArray>;
+            t.kernel[RGBArray][RGBArray] = &copy_field<FColorRGBArray>;
+            t.kernel[RGBAArray][RGBAArray] = &copy_field<FColorRGBAArray>;
+            t.kernel[Time][Time] = &copy_field<FTime>;
+
+            t.kernel[Bool][Int] = &convert_field<FBool,FInt>;
+            t.kernel[Int][Float] = &convert_field<FInt,FFloat>;
+            t.kernel[Int][Double] = &convert_field<FInt,FDouble>;
+            t.kernel[Int][Real] = &convert_field<FInt,FReal>;
+            t.kernel[Float][Double] = &convert_field<FFloat,FDouble>;
+            t.kernel[Float][Real] = &convert_field<FFloat,FReal>;
+            t.kernel[Double][Real] = &convert_field<FDouble,FReal>;
+            t.kernel[Real][Double] = &convert_field<FReal,FDouble>;
+            t.kernel[Vertex][Vector] = &convert_field<FVertex3D,FVector3D>;
+            t.kernel[RGB][RGBA] = &convert_field<FColorRGB,FColorRGBA>;
+
+            t.kernel[BoolArray][IntArray] = &convert_field<FBoolArray,FIntArray>;
+            t.kernel[IntArray][FloatArray] = &convert_field<FIntArray,FFloatArray>;
+            t.kernel[VertexArray][VectorArray] = &convert_field<FVertex3DArray,FVectorArray>;
+            t.kernel[RGBArray][RGBAArray] = &convert_field<FColorRGBArray,FColorRGBAArray>;
+            return t;
+        };
+
+        constexpr ConverterTable converter_table = make_converter_table();
+
+        // every connection the connection table allows between types with a value has a kernel and nothing else does
+        constexpr bool converters_match()
+        {
+            for(int i=0; i < START; i++)
+                for(int j=0; j < START; j++)
+                    if((connection_kind(i,j) != conversion::None && has_value(i)) != (converter_table.kernel[i][j] != nullptr))
+                        return false;
+            return true;
+        };
+
+        static_assert(converters_match(), "the converter table doesn't match the connection table");
+
+        /*
+         * The kernel that puts the value of a t1 field into a t2 input it's
+         * connected to, a copy or a conversion. It's null for the types that
+         * don't hold a value, like Node, and for types that can't connect.
+         */
+        inline Converter converter(int t1, int t2)
+        {
+            return (static_cast<unsigned int>(t1) < START && static_cast<unsigned int>(t2) < START) ? converter_table.kernel[t1][t2] : nullptr;
+        };
+
+    } // namespace field
+
+} // namespace feather
+
+#endif
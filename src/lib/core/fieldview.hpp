@@ -0,0 +1,93 @@
+/***********************************************************************
+ *
+ * Filename: fieldview.hpp
+ *
+ * Description: Read only access to a field value without copying it.
+ *
+ * Copyright (C) 2015 Richard Layman, rlayman2000@yahoo.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+
+#ifndef FIELDVIEW_HPP
+#define FIELDVIEW_HPP
+
+#include "deps.hpp"
+#include "types.hpp"
+#include "field.hpp"
+#include "fieldvalue.hpp"
+
+namespace feather
+{
+
+    namespace field
+    {
+
+        // true if the field's type enum holds a _Type
+        template <typename _Type>
+        bool holds_type(FieldBase* f)
+        {
+            bool same=false;
+            with_value_type(f->type,[&same](auto tag){ same = std::is_same<typename decltype(tag)::type,_Type>::value; });
+            return same;
+        };
+
+        /*
+         * A FieldView reads a field's value where it's stored in the scene.
+         * It holds the scene's read lock while it's alive, so the scene can't
+         * update or remove nodes until the view is gone and the value can't
+         * change under the reader. Keep views short lived and never update
+         * the scene from the thread holding one, it would wait on itself.
+         * An empty view, one with no field, doesn't hold the lock.
+         */
+        template <typename _Type>
+        class FieldView
+        {
+            public:
+                typedef std::shared_lock<std::shared_timed_mutex> Lock;
+
+                FieldView() : m_field(nullptr) {};
+                FieldView(Lock&& lock, const Field<_Type>* field) : m_lock(std::move(lock)),m_field(field) {};
+                FieldView(FieldView&&) = default;
+                FieldView& operator=(FieldView&&) = default;
+
+                bool valid() const { return m_field!=nullptr; };
+                explicit operator bool() const { return valid(); };
+
+                const _Type& value() const { return m_field->value; };
+                const _Type& operator*() const { return m_field->value; };
+                const _Type* operator->() const { return &m_field->value; };
+
+                // let go of the field and the lock before the view goes away
+                void release() {
+                    m_field = nullptr;
+                    if(m_lock.owns_lock())
+                        m_lock.unlock();
+                };
+
+            private:
+                FieldView(FieldView const&);
+                FieldView& operator=(FieldView const&);
+
+                Lock m_lock;
+                const Field<_Type>* m_field;
+        };
+
+    } // namespace field
+
+} // namespace feather
+
+#endif
@@ -0,0 +1,167 @@
+/***********************************************************************
+ *
+ * Filename: frames.hpp
+ *
+ * Description: Evaluates the scenegraph nodes at a frame on a worker thread.
+ *
+ * Copyright (C) 2015 Richard Layman, rlayman2000@yahoo.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef FRAMES_HPP
+#define FRAMES_HPP
+
+#include "deps.hpp"
+#include "types.hpp"
+#include "field.hpp"
+#include "fieldvalue.hpp"
+#include "pluginmanager.hpp"
+
+namespace feather
+{
+
+    // the values of the requested output fields at one frame
+    struct FFrame
+    {
+        FFrame(FReal _time=0) : time(_time) {};
+        FReal time;
+        std::vector<std::shared_ptr<field::FieldBase> > values; // null if the field's value couldn't be copied
+    };
+
+    /*
+     * A FrameView lets a worker thread evaluate the scene's nodes at it's own
+     * time without touching the scene. The view gets it's own copy of every
+     * field the plan's nodes have, and of the fields outside the plan that
+     * they read, so after it's made the view never looks at the scene and
+     * the scene's lock can be let go. Only the constructor reads the scene,
+     * and the plan has to outlive the view.
+     * Each step pulls it's connected inputs from the view's copy of the
+     * source, so the view's time reaches every node downstream of it. If the
+     * time is the output of a node in the plan that node isn't run, it would
+     * overwrite the time.
+     * The nodes are run in the plan's order without the dirty flags or the
+     * node caches, both of which belong to the scene.
+     */
+    class FrameView
+    {
+        public:
+            FrameView(const FEvalPlan& plan, field::FieldBase* time) : m_plan(plan),m_time(nullptr),m_time_step(-1),m_time_value(0) {
+                m_fields.resize(plan.steps.size());
+                for(unsigned int i=0; i < plan.steps.size(); i++) {
+                    for(field::FieldBase* f : *plan.steps[i].fields) {
+                        field::FieldBase* v = copy(f);
+                        if(f==time) {
+                            m_time = v;
+                            m_time_step = i;
+                        }
+                        m_fields[i].push_back(v);
+                    }
+                }
+                // the time node is not in the plan, the inputs connected to it read this copy
+                if(!m_time)
+                    m_time = copy(time);
+
+                m_sources.assign(plan.inputs.size(),nullptr);
+                for(unsigned int n=0; n < plan.inputs.size(); n++) {
+                    const FEvalInput& in = plan.inputs[n];
+                    if(in.step < 0)
+                        m_sources[n] = (in.src==time) ? m_time : copy(in.src);
+                }
+            };
+
+            ~FrameView() {
+                for(field::FieldBase* f : m_copies) {
+                    if(f->type == field::Node)
+                        delete static_cast<field::Field<FNode>*>(f);
+                    else
+                        field::delete_field(f);
+                }
+            };
+
+            // set the time field's value, it needs to be a number
+            bool set_time(FReal time) {
+                m_time_value = time;
+                return write_time();
+            };
+
+            void run(PluginManager& plugins) {
+                for(unsigned int i=0; i < m_plan.steps.size(); i++) {
+                    m_plan.pull_inputs(i,[this](const FEvalInput& in){ return source(in); },m_fields[i]);
+                    if(static_cast<int>(i) == m_time_step) {
+                        // a connected time input was just pulled over
+                        if(m_time->conn_type == field::connection::Out)
+                            continue;
+                        write_time();
+                    }
+                    plugins.do_it(m_plan.steps[i].nid,m_fields[i]);
+                }
+            };
+
+            // the view's field or null if the node isn't in the plan
+            field::FieldBase* get_field(unsigned int uid, int fid) {
+                if(uid >= m_plan.position.size() || m_plan.position[uid] < 0)
+                    return nullptr;
+                for(field::FieldBase* f : m_fields[m_plan.position[uid]]) {
+                    if(f->id == fid)
+                        return f;
+                }
+                return nullptr;
+            };
+
+        private:
+            FrameView(FrameView const&);
+            FrameView& operator=(FrameView const&);
+
+            // node fields don't have a value type but the plugins' do_its can still read them
+            field::FieldBase* copy(field::FieldBase* f) {
+                field::FieldBase* v = (f->type == field::Node) ? new field::Field<FNode>(*static_cast<field::Field<FNode>*>(f)) : field::clone_field(f);
+                if(!v)
+                    return f;
+                m_copies.push_back(v);
+                return v;
+            };
+
+            bool write_time() {
+                switch(m_time->type)
+                {
+                    case field::Int: static_cast<field::Field<FInt>*>(m_time)->value = m_time_value; break;
+                    case field::Float: static_cast<field::Field<FFloat>*>(m_time)->value = m_time_value; break;
+                    case field::Double: static_cast<field::Field<FDouble>*>(m_time)->value = m_time_value; break;
+                    case field::Real: static_cast<field::Field<FReal>*>(m_time)->value = m_time_value; break;
+                    default: return false;
+                }
+                return true;
+            };
+
+            // the view's field an input reads
+            field::FieldBase* source(const FEvalInput& in) {
+                if(in.step >= 0)
+                    return m_fields[in.step][in.src_slot];
+                return m_sources[&in - m_plan.inputs.data()];
+            };
+
+            const FEvalPlan& m_plan;
+            std::vector<field::Fields> m_fields; // fields of each plan step
+            field::Fields m_sources; // copies of the fields outside the plan that each input reads
+            field::Fields m_copies;
+            field::FieldBase* m_time;
+            int m_time_step; // step of the node the time field belongs to, -1 if it's not in the plan
+            FReal m_time_value;
+    };
+
+} // namespace feather
+
+#endif
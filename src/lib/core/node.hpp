@@ -135,11 +135,11 @@ namespace feather
         };\
         \
         template <> struct find_create_fields<__node_enum> {\
-            static  status exec(int id, field::Fields& fields) {\
+            static  status exec(int id, field::Fields& fields, field::FieldStore& store) {\
                 if(id==__node_enum){\
-                    return add_fields<__node_enum,600>::exec(fields);\
+                    return add_fields<__node_enum,MAX_FIELD_ID>::exec(fields,store);\
                 } else {\
-                    return find_create_fields<__node_enum-1>::exec(id,fields);\
+                    return find_create_fields<__node_enum-1>::exec(id,fields,store);\
                 }\
                 return status();\
             };\
@@ -37,9 +37,9 @@ PluginManager::~PluginManager()
         dlclose(n.handle);
 }
 
-status PluginManager::load_plugins()
+status PluginManager::load_plugins(std::string path)
 {
-    boost::filesystem::path plugin_path("/usr/local/feather/plugins");
+    boost::filesystem::path plugin_path(path);
     typedef std::vector<boost::filesystem::path> files;
     files plugin_paths;
 
@@ -59,6 +59,8 @@ status PluginManager::load_plugins()
                     PluginData node;
                     node.path = (*it).string();
                     status s = load_node(node);
+                    if(s.state)
+                        s = load_fields(node);
                     if(s.state){
                         m_plugins.push_back(node);
                         std::cout << node.path << " loaded\n";
@@ -80,7 +82,6 @@ status PluginManager::load_plugins()
 
 status PluginManager::do_it(int node, field::Fields&  fields)
 {
-    std::cout << "call node " << node << std::endl;
     std::for_each(m_plugins.begin(),m_plugins.end(), call_do_it(node,fields) );
     return status();
 }
@@ -115,8 +116,9 @@ status PluginManager::load_node(PluginData &node)
     node.node_draw_items = (status(*)(int,draw::DrawItems&))dlsym(node.handle, "node_draw_items");
     node.node_type = (status(*)(int,node::Type&))dlsym(node.handle, "node_type");
     node.node_icon = (bool(*)(int,std::string&))dlsym(node.handle, "node_icon");
-    node.create_fields = (status(*)(int,field::Fields&))dlsym(node.handle,"create_fields");
+    node.create_fields = (status(*)(int,field::Fields&,field::FieldStore&))dlsym(node.handle,"create_fields");
     node.get_field = (field::FieldBase*(*)(int,int,field::Fields&))dlsym(node.handle, "get_field");
+    node.field_slots = (status(*)(int,field::FieldSlots&))dlsym(node.handle, "field_slots");
     node.get_fid_list = (status(*)(int,field::connection::Type,field::Fields&,std::vector<field::FieldBase*>&))dlsym(node.handle, "get_fid_list");
     node.command_exist = (bool(*)(std::string))dlsym(node.handle, "command_exist");
     node.command = (status(*)(std::string,parameter::ParameterList))dlsym(node.handle, "command");
@@ -137,12 +139,33 @@ status PluginManager::load_node(PluginData &node)
     return status();
 }
 
-status PluginManager::create_fields(int node, field::Fields& fields)
+// every node of a type has it's fields in the same order, so the slots are worked out once here
+status PluginManager::load_fields(PluginData &node)
+{
+    // a plugin built before the slot tables doesn't have it
+    if(!node.field_slots) {
+        fprintf(stderr, "%s has no field_slots, it needs to be rebuilt\n", node.path.c_str());
+        return status(FAILED,"plugin has no field_slots");
+    }
+
+    for(int nid=1; nid <= MAX_NODE_ID; nid++) {
+        if(!node.node_exist(nid))
+            continue;
+        if(m_field_slots.size() <= static_cast<unsigned int>(nid))
+            m_field_slots.resize(nid+1);
+        status p = node.field_slots(nid,m_field_slots[nid]);
+        if(p.state==FAILED)
+            return p;
+    }
+    return status();
+}
+
+status PluginManager::create_fields(int node, field::Fields& fields, field::FieldStore& store)
 {
     std::cout << "create field for node " << node << std::endl;
     for(uint i=0; i < m_plugins.size(); i++) {
         if(m_plugins[i].node_exist(node))
-            return m_plugins[i].create_fields(node,fields);
+            return m_plugins[i].create_fields(node,fields,store);
     }
     return status();
 }
@@ -154,17 +177,10 @@ void PluginManager::get_draw_items(int nid, draw::DrawItems& items)
 
 field::FieldBase* PluginManager::get_fieldBase(int uid, int node, int field, field::Fields& fields)
 {
-    for(uint i=0; i < m_plugins.size(); i++) {
-        //std::cout << "looking in plugin "  << i << " for node " << node << std::endl;
-        if(m_plugins[i].node_exist(node)) {
-            //std::cout << "Found node " << node << std::endl;
-            // TODO - I need to verify that the field data actually exists
-            //std::cout << "PluginManager::get_fieldBase(" << uid << "," << node << "," << field << "," << &fields << ")\n";
-            return m_plugins[i].get_field(node,field,fields);
-        }
-    }
-    //std::cout << "Never found node " << node << std::endl;
-    return nullptr;
+    const int slot = field_slot(node,field);
+    if(slot < 0 || static_cast<unsigned int>(slot) >= fields.size())
+        return nullptr;
+    return fields[slot];
 }
 
 status PluginManager::load_command(PluginData &command)
@@ -263,6 +279,29 @@ status PluginManager::node_type(int nid, feather::node::Type& type)
     return status();
 }
 
+int PluginManager::node_plugin(int nid)
+{
+    for(uint i=0; i < m_plugins.size(); i++) {
+        if(m_plugins[i].node_exist(nid))
+            return i;
+    }
+    return -1;
+}
+
+status PluginManager::node_type(int plugin, int nid, feather::node::Type& type)
+{
+    if(plugin < 0 || plugin >= static_cast<int>(m_plugins.size()))
+        return status(FAILED,"no plugin for the node");
+    return m_plugins[plugin].node_type(nid,type);
+}
+
+status PluginManager::create_fields(int plugin, int nid, field::Fields& fields, field::FieldStore& store)
+{
+    if(plugin < 0 || plugin >= static_cast<int>(m_plugins.size()))
+        return status(FAILED,"no plugin for the node");
+    return m_plugins[plugin].create_fields(nid,fields,store);
+}
+
 void PluginManager::loaded_plugins(std::vector<PluginInfo>& list)
 {
     get_name info(list);
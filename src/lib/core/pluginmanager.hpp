@@ -30,8 +30,10 @@
 #include "parameter.hpp"
 #include "field.hpp"
 #include "draw.hpp"
+#include "fieldstore.hpp"
 
 #define MAX_NODE_ID 800
+#define MAX_FIELD_ID 600
 
 namespace feather
 {
@@ -55,8 +57,9 @@ namespace feather
         status (*node_draw_items)(int,draw::DrawItems&); // can the node be drawn in the viewport
         status (*node_type)(int,node::Type&);
         bool (*node_icon)(int,std::string&); // name of icon image in ui/icons path
-        status(*create_fields)(int,field::Fields&); // creates a new instance of the nodes fields which will get deleted by the scenegraph when the node is removed.
+        status(*create_fields)(int,field::Fields&,field::FieldStore&); // creates a new instance of the nodes fields in the scene's field store, they get deleted when the scene is cleared.
         field::FieldBase* (*get_field)(int,int,field::Fields&);
+        status (*field_slots)(int,field::FieldSlots&); // makes the node type's fid to slot table
         status (*get_fid_list)(int,field::connection::Type,field::Fields&,std::vector<field::FieldBase*>&);
         bool (*command_exist)(std::string cmd);
         status (*command)(std::string cmd, parameter::ParameterList);
@@ -200,44 +203,75 @@ namespace feather
 
     // GET FIELD DATA
 
+    // the fid to slot table of each of the plugin's node types by nid, see make_field_slots()
+    inline std::vector<field::FieldSlots>& plugin_field_slots()
+    {
+        static std::vector<field::FieldSlots> slots;
+        return slots;
+    };
+
+    // the node's field for the fid, NULL if the node type has no such field
+    inline field::FieldBase* plugin_field(int nid, int fid, field::Fields& fields)
+    {
+        const std::vector<field::FieldSlots>& slots = plugin_field_slots();
+        if(static_cast<unsigned int>(nid) >= slots.size() || static_cast<unsigned int>(fid) >= slots[nid].size() || slots[nid][fid] < 0)
+            return NULL;
+        return fields[slots[nid][fid]];
+    };
+
     template <int _NodeId, int _FieldId>
     field::FieldBase* field_data(field::Fields& fields) { return NULL; };  
 
-    // remember that the StartFieldId has to be the last field id + 1
-    template <int _NodeId, int _StartFieldId>
-    struct find_field {
-        static field::FieldBase* exec(int fid, field::Fields& fields) {
-            return find_field<_NodeId,_StartFieldId-1>::exec(fid,fields);
-        };
+    // FIELD HANDLES
+
+    // the type of the node's field, ADD_FIELD_TO_NODE sets it for each field
+    template <int _NodeId, int _FieldId>
+    struct field_type { typedef void type; };
+
+    /*
+     * Where the field is in the node's Fields. add_fields pushes the fields
+     * from the highest fid down, so it's the number of the node's fields
+     * that have a higher fid.
+     */
+    template <int _NodeId, int _FieldId>
+    struct field_slot {
+        static const int value = field_slot<_NodeId,_FieldId+1>::value + (std::is_void<typename field_type<_NodeId,_FieldId+1>::type>::value ? 0 : 1);
     };
 
     template <int _NodeId>
-    struct find_field<_NodeId,0> {
-        static field::FieldBase* exec(int fid, field::Fields& fields) {
-            return NULL;
-        };
-    };
+    struct field_slot<_NodeId,MAX_FIELD_ID> { static const int value = 0; };
 
-    template <int _EndNode, int _StartNode, int _StartField>
-        struct find_node_field {
-            static field::FieldBase* exec(int nid, int fid, field::Fields& fields) {
-                if(nid==_StartNode) {
-                    return find_field<_StartNode,_StartField>::exec(fid,fields);
-                }
-                else
-                    return find_node_field<_EndNode,_StartNode-1,_StartField>::exec(nid,fid,fields);
+    /*
+     * Typed access to a node's field from inside it's DO_IT:
+     *
+     *     FieldHandle<MYNODE,3,FInt> a(fields);
+     *     a->value = 1;
+     *
+     * The field's slot in the node's Fields is worked out at compile time,
+     * so getting the field is one load. Using a fid the node doesn't have
+     * or the wrong type won't compile. The node's fields have to be added
+     * before the handle is used, adding one after is a compile error.
+     */
+    template <int _NodeId, int _FieldId, typename _Type>
+    class FieldHandle
+    {
+        static_assert(std::is_same<typename field_type<_NodeId,_FieldId>::type,_Type>::value, "the node has no field with this fid and type");
+
+        public:
+            static const int slot = field_slot<_NodeId,_FieldId>::value;
+
+            FieldHandle(field::Fields& fields) : m_field(static_cast<field::Field<_Type>*>(fields[slot])) {
+                assert(m_field->id == _FieldId);
             };
-        };
 
-    template <int _StartNode, int _StartField>
-        struct find_node_field<_StartNode,_StartNode,_StartField> {
-            static field::FieldBase* exec(int nid, int fid, field::Fields& fields) {
-                if(nid==_StartNode)
-                    return find_field<_StartNode,_StartField>::exec(fid,fields);
-                else 
-                    return NULL;
-            }; 
-        };
+            field::Field<_Type>* get() const { return m_field; };
+            field::Field<_Type>* operator->() const { return m_field; };
+            field::Field<_Type>& operator*() const { return *m_field; };
+            _Type& value() const { return m_field->value; };
+
+        private:
+            field::Field<_Type>* m_field;
+    };
 
 
     // GET NODE'S FIDs
@@ -296,21 +330,43 @@ namespace feather
     // Add Field is used to setup the Fields vector 
     template <int _Node, int _StartKey>
     struct add_fields {
-        static status exec(field::Fields& fields) {
-            return add_fields<_Node,_StartKey-1>::exec(fields);
+        static status exec(field::Fields& fields, field::FieldStore& store) {
+            return add_fields<_Node,_StartKey-1>::exec(fields,store);
         };
     };
 
-    template <int _Node> struct add_fields<_Node,0> { static status exec(field::Fields& fields) { return status(); }; };
+    template <int _Node> struct add_fields<_Node,0> { static status exec(field::Fields& fields, field::FieldStore& store) { return status(); }; };
 
     // Create Fields is used to get the field into the sg node container
 
     template <int _Id>
     struct find_create_fields {
-        static  status exec(int id, field::Fields& fields) { return find_create_fields<_Id-1>::exec(id,fields); };
+        static  status exec(int id, field::Fields& fields, field::FieldStore& store) { return find_create_fields<_Id-1>::exec(id,fields,store); };
     };
 
-    template <> struct find_create_fields<0> { static status exec(int id, field::Fields& fields) { return status(FAILED,"No matching node found to create fields in"); }; };
+    template <> struct find_create_fields<0> { static status exec(int id, field::Fields& fields, field::FieldStore& store) { return status(FAILED,"No matching node found to create fields in"); }; };
+
+    /*
+     * Makes the fid to slot table of a node type from the fields of a node
+     * made just for it. This is done once when the plugin is loaded, the
+     * plugin keeps the table for field_data() and gives it to the plugin
+     * manager for the scenegraph.
+     */
+    template <int _MaxNode>
+    status make_field_slots(int nid, field::FieldSlots& slots) {
+        Arena arena;
+        field::FieldStore store(arena);
+        field::Fields fields;
+        status p = find_create_fields<_MaxNode>::exec(nid,fields,store);
+        if(p.state==FAILED)
+            return p;
+        slots = field::field_slots(fields);
+        std::vector<field::FieldSlots>& table = plugin_field_slots();
+        if(table.size() <= static_cast<unsigned int>(nid))
+            table.resize(nid+1);
+        table[nid] = slots;
+        return status();
+    };
 
 
     // NODE ICON IMAGE 
@@ -362,10 +418,10 @@ namespace feather
         public:
             PluginManager();
             ~PluginManager();
-            status load_plugins();
+            status load_plugins(std::string path="/usr/local/feather/plugins"); // loads every .so in the path
             status do_it(int node,field::Fields& fields); // this is called by the scenegraph
             //status draw_it(int node,draw::DrawItems& items); // this is called by the scenegraph
-            status create_fields(int node, field::Fields& fields); // this will return a new instance of the node's fields 
+            status create_fields(int node, field::Fields& fields, field::FieldStore& store); // this will return a new instance of the node's fields 
             void get_draw_items(const int nid, draw::DrawItems& items);
             field::FieldBase* get_fieldBase(int uid, int node, int field, field::Fields& fields);
             status run_command(std::string cmd, parameter::ParameterList);
@@ -374,15 +430,29 @@ namespace feather
             int max_uid();
             status node_icon_file(int nid, std::string& file);
             status node_type(int nid, feather::node::Type& type);
+            // index of the plugin that has the node, -1 if none do
+            // The plugin can then be used with the calls below so it's only looked up once per node type.
+            int node_plugin(int nid);
+            status node_type(int plugin, int nid, feather::node::Type& type);
+            status create_fields(int plugin, int nid, field::Fields& fields, field::FieldStore& store);
             void loaded_plugins(std::vector<PluginInfo>& list);
             status get_fid_list(int nid, field::connection::Type conn, field::Fields& fields, std::vector<field::FieldBase*>& list);
 
+            // where the fid is in the Fields of the nid's nodes, -1 if the nid has no such field
+            int field_slot(int nid, int fid) const {
+                if(static_cast<unsigned int>(nid) >= m_field_slots.size() || static_cast<unsigned int>(fid) >= m_field_slots[nid].size())
+                    return -1;
+                return m_field_slots[nid][fid];
+            };
+
         private:
             bool add_parameter_to_list(std::string cmd, int key, std::string val, parameter::ParameterList& list);
             status load_node(PluginData &node);
+            status load_fields(PluginData &node);
             status load_command(PluginData &command);
             std::string m_pluginPath;
             std::vector<PluginData> m_plugins;
+            std::vector<field::FieldSlots> m_field_slots; // by nid, made when the node's plugin is loaded
     };
 
 } // namespace feather
@@ -398,8 +468,9 @@ namespace feather
     feather::status node_draw_items(int,feather::draw::DrawItems&);\
     feather::status node_type(int,feather::node::Type&);\
     bool node_icon(int,std::string&);\
-    feather::status create_fields(int, feather::field::Fields&);\
+    feather::status create_fields(int, feather::field::Fields&, feather::field::FieldStore&);\
     feather::field::FieldBase* get_field(int,int,feather::field::Fields&);\
+    feather::status field_slots(int,feather::field::FieldSlots&);\
     feather::status get_fid_list(int,feather::field::connection::Type,feather::field::Fields&,std::vector<feather::field::FieldBase*>&);\
     bool command_exist(std::string cmd);\
     feather::status command(std::string cmd, feather::parameter::ParameterList);\
@@ -451,13 +522,18 @@ namespace feather
     };\
     \
     /* create a node field */\
-    feather::status create_fields(int id,feather::field::Fields& fields) {\
-        return find_create_fields<MAX_NODE_ID>::exec(id,fields);\
+    feather::status create_fields(int id,feather::field::Fields& fields, feather::field::FieldStore& store) {\
+        return find_create_fields<MAX_NODE_ID>::exec(id,fields,store);\
     };\
     \
     /* find the node's field */\
     feather::field::FieldBase* get_field(int nid, int fid, field::Fields& fields) {\
-        return find_node_field<startnode,endnode,50>::exec(nid,fid,fields);\
+        return plugin_field(nid,fid,fields);\
+    };\
+    \
+    /* make the node's fid to slot table, called when the plugin is loaded */\
+    feather::status field_slots(int nid, feather::field::FieldSlots& slots) {\
+        return make_field_slots<MAX_NODE_ID>(nid,slots);\
     };\
     /* find the node's fid's*/\
     feather::status get_fid_list(int nid, feather::field::connection::Type conn, feather::field::Fields& fields, std::vector<feather::field::FieldBase*>& list) {\
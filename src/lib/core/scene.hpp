@@ -0,0 +1,79 @@
+/***********************************************************************
+ *
+ * Filename: scene.hpp
+ *
+ * Description: Everything that makes up one scenegraph.
+ *
+ * Copyright (C) 2015 Richard Layman, rlayman2000@yahoo.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+#include "deps.hpp"
+#include "types.hpp"
+#include "state.hpp"
+#include "selection.hpp"
+#include "threadpool.hpp"
+#include "topoorder.hpp"
+#include "snapshot.hpp"
+#include "arena.hpp"
+#include "fieldstore.hpp"
+#include "events.hpp"
+
+namespace feather
+{
+
+    /*
+     * A Scene holds the node graph and everything that goes with it - the
+     * state, layers, time, selection, evaluation plan and update threads.
+     * Scenes don't share anything but the plugins, so different threads
+     * can each work on their own scene at the same time.
+     * The scenegraph functions work on the calling thread's current scene,
+     * see scenegraph::scene().
+     */
+    struct Scene
+    {
+        Scene() : time(),field_store(arena),version(0) {};
+        state::FState cstate;
+        std::vector<FLayer> layers;
+        FTime time;
+        Arena arena; // the node fields, freed all at once by clear(), only used under the write lock
+        field::FieldStore field_store; // the node fields by node type, it's columns are in the arena
+        FSceneGraph sg;
+        std::vector<unsigned int> generation; // generation of each node slot
+        std::deque<unsigned int> free_slots; // slots of removed nodes, the oldest first
+        std::unordered_map<std::string,std::set<unsigned int> > names; // uids of the nodes with each name
+        std::map<node::Type,std::set<unsigned int> > types; // uids of the nodes of each type
+        std::vector<FNodeDescriptor> node_selection;
+        selection::SelectionManager selection;
+        TopoOrder order; // every node comes after the nodes feeding it
+        FEvalPlan eval_plan; // order the nodes get updated in
+        GraphSnapshot snapshot; // flat copy of the connections, rebuilt when read after a topology change
+        ThreadPool eval_pool; // workers used by the Levels and Tasks schedules
+        std::shared_timed_mutex lock; // shared by the field views, everything that changes the graph or writes fields takes it alone
+        event::EventBus events; // what changed since the widgets last looked
+        std::atomic<uint64_t> version; // goes up by one for each write, field and node versions come from it
+
+        private:
+            Scene(Scene const&);
+            Scene& operator=(Scene const&);
+    };
+
+} // namespace feather
+
+#endif
@@ -38,6 +38,12 @@
 #include "shader.hpp"
 #include "pluginmanager.hpp"
 #include "state.hpp"
+#include "threadpool.hpp"
+#include "taskscheduler.hpp"
+#include "cache.hpp"
+#include "scene.hpp"
+#include "frames.hpp"
+#include "fieldview.hpp"
 
 namespace feather
 {
@@ -66,36 +72,174 @@ namespace feather
      * The datablock location is kept in sync with the vertex number by the datamanager.
      */
 
-    static state::FState cstate;
-    static std::vector<FLayer> layers;
-    static FTime time;
-    static FSceneGraph sg;
+    /*
+     * The plugins are loaded once and shared by every scene, everything
+     * else belongs to a Scene.
+     */
     static PluginManager plugins;
-    static std::vector<FNodeDescriptor> node_selection;
 
     namespace scenegraph
     {
 
-        /* clear the scenegraph */
+        /*
+         * Each thread works on it's own current scene. Until a thread sets one
+         * it uses the default scene, which is the one the ui works on.
+         * A batch process can give each worker thread it's own Scene:
+         *
+         *     Scene shot;
+         *     scenegraph::SceneScope scope(shot);
+         *     scenegraph::add_node(...);
+         *     scenegraph::update();
+         */
+        Scene& default_scene() { static Scene s; return s; };
+
+        Scene*& current_scene() { thread_local Scene* s = nullptr; return s; };
+
+        Scene& scene() {
+            Scene* s = current_scene();
+            return (s) ? *s : default_scene();
+        };
+
+        /* pass null to go back to the default scene */
+        void set_scene(Scene* s) { current_scene() = s; };
+
+        /* makes the scene current until the end of the block */
+        class SceneScope
+        {
+            public:
+                SceneScope(Scene& s) : m_prev(current_scene()) { current_scene() = &s; };
+                ~SceneScope() { current_scene() = m_prev; };
+            private:
+                SceneScope(SceneScope const&);
+                SceneScope& operator=(SceneScope const&);
+                Scene* m_prev;
+        };
+
+        /* The evaluation plan and the snapshot have to be rebuilt after any topology change */
+        void invalidate_plan() {
+            scene().eval_plan.valid = false;
+            scene().snapshot.invalidate();
+        };
+
+        /*
+         * The scene's connections in flat arrays, for code that walks the graph a lot.
+         * The reference stays good until the next topology change.
+         */
+        const GraphSnapshot& snapshot() {
+            Scene& s = scene();
+            if(!s.snapshot.valid())
+                s.snapshot.build(s.sg);
+            return s.snapshot;
+        };
+
+        // the scene's field and topology change events, see event::EventBus
+        event::EventBus& events() { return scene().events; };
+
+        /*
+         * Call after writing the field that get_fieldBase() found for the
+         * fid from outside a do_it, it gets a new version and goes to the
+         * event bus. The write and this call have to be made holding the
+         * scene's write lock, set_field_value() does all of it.
+         */
+        void field_written(unsigned int uid, unsigned int fid, field::FieldBase* f) {
+            Scene& s = scene();
+            f->version = ++s.version;
+            s.events.field_changed(uid,fid,f->version);
+        };
+
+        /*
+         * The name and type indexes let nodes be looked up without going
+         * through every vertex. A node has to be taken out of them before
+         * it's name or type changes.
+         */
+        void index_node(unsigned int uid) {
+            Scene& s = scene();
+            s.names[s.sg[uid].name].insert(uid);
+            s.types[s.sg[uid].type].insert(uid);
+        }
+
+        void unindex_node(unsigned int uid) {
+            Scene& s = scene();
+            auto n = s.names.find(s.sg[uid].name);
+            if(n != s.names.end()) {
+                n->second.erase(uid);
+                if(n->second.empty())
+                    s.names.erase(n);
+            }
+            auto t = s.types.find(s.sg[uid].type);
+            if(t != s.types.end()) {
+                t->second.erase(uid);
+                if(t->second.empty())
+                    s.types.erase(t);
+            }
+        }
+
+        /*
+         * Slot for a new node, the slot that has been empty the longest is
+         * reused so a stale uid takes as long as possible to point to a new node
+         */
+        FNodeDescriptor take_node_slot() {
+            Scene& s = scene();
+            FNodeDescriptor uid;
+            if(!s.free_slots.empty()) {
+                uid = s.free_slots.front();
+                s.free_slots.pop_front();
+                s.sg[uid] = FNode();
+            } else {
+                uid = boost::add_vertex(s.sg);
+                s.order.add_node();
+                if(s.generation.size() <= uid)
+                    s.generation.push_back(0);
+            }
+            return uid;
+        }
+
+        /*
+         * clear the scenegraph
+         * All the nodes, the root included, are dropped in one go and the
+         * arena is reset, which frees every field of the scene.
+         * The root is then made again with new fields.
+         */
         void clear() {
+            Scene& s = scene();
+            std::unique_lock<std::shared_timed_mutex> write(s.lock);
+            FSceneGraph& sg = s.sg;
             // clear the selection
-            smg::Instance()->clear();
-
-            int v = boost::num_vertices(sg);
-            std::cout << "v count " << v << std::endl;
-            v-=1;
-
-            while(v>0){
-                std::cout  << "clearing v " << v << std::endl;
-                // clear the edges
-                boost::clear_vertex(v,sg);
-                // clear the vertexes
-                boost::remove_vertex(v,sg);
-                v-=1;
-            }
+            s.selection.clear();
+            invalidate_plan();
+            s.events.topology_changed(0,event::Cleared);
+
+            // handles to the removed nodes are stale from now on
+            for(unsigned int v=1; v < s.generation.size(); v++)
+                s.generation[v]++;
+
+            const bool root = num_vertices(sg) > 0;
+            FNode old_root = (root) ? sg[0] : FNode();
+
+            sg.clear();
+            s.field_store.clear();
+            s.arena.reset();
+            s.free_slots.clear();
+            s.order.clear();
+            s.names.clear();
+            s.types.clear();
+
+            if(!root)
+                return;
+
+            // only the root is left
+            FNodeDescriptor uid = take_node_slot();
+            sg[uid].type = old_root.type;
+            sg[uid].uid = uid;
+            sg[uid].node = old_root.node;
+            sg[uid].name = old_root.name;
+            sg[uid].layer = old_root.layer;
+            sg[uid].row = s.field_store.add_row(old_root.node,uid);
+            plugins.create_fields(old_root.node,sg[uid].fields,s.field_store);
+            index_node(uid);
 
             // this is currently needed to update sg
-            smg::Instance()->add_state(static_cast<selection::Type>(sg[0].type),0,sg[0].node);
+            s.selection.add_state(static_cast<selection::Type>(sg[0].type),0,sg[0].node);
  
             /* 
             for_each(sg.begin(); sg.end(); [](int v){
@@ -109,23 +253,34 @@ namespace feather
 
         int get_min_uid() { return plugins.min_uid(); };
         //int get_max_uid() { return plugins.max_uid(); };
-        int get_max_uid() { return num_vertices(sg)-1; };
+        int get_max_uid() { return num_vertices(scene().sg)-1; };
 
         status load_plugins() {
             return plugins.load_plugins();
         };
 
+        // load the plugins of another directory, the tests use this for their own plugin
+        status load_plugins(std::string path) {
+            return plugins.load_plugins(path);
+        };
+
 
         
         // NODES
 
         bool node_exist(unsigned int uid) {
-            unsigned int count = num_vertices(sg);
-            for(unsigned int i=0; i < count; i++) {
-                if(i==uid)
-                    return true;
-            }
-            return false;
+            FSceneGraph& sg = scene().sg;
+            return uid < num_vertices(sg) && !sg[uid].removed;
+        }
+
+        FNodeHandle get_node_handle(unsigned int uid) {
+            Scene& s = scene();
+            return FNodeHandle(uid,(uid < s.generation.size()) ? s.generation[uid] : 0);
+        }
+
+        /* false if the handle's node was removed, even if another node now has the same uid */
+        bool node_valid(FNodeHandle handle) {
+            return node_exist(handle.uid) && scene().generation[handle.uid] == handle.generation;
         }
         
         /* Add Node
@@ -140,22 +295,29 @@ namespace feather
 
         //int add_node(int t, int n, std::string name) {
         unsigned int add_node(const unsigned int n, const std::string name, status& error) {
+            // the node's fields are made in the scene's arena
+            std::unique_lock<std::shared_timed_mutex> write(scene().lock);
+            FSceneGraph& sg = scene().sg;
+            state::FState& cstate = scene().cstate;
             //std::cout << "add node: " << n << ", type: " << t << std::endl;
             feather::node::Type ntype;
             plugins.node_type(n,ntype);
-            std::cout << "add node: " << n << " type: " << ntype << std::endl;
 
             // TODO
             // Here I need to ask the plugin manager if the node exists
  
-            FNodeDescriptor uid = boost::add_vertex(sg);
+            FNodeDescriptor uid = take_node_slot();
             //sg[uid].type = static_cast<feather::node::Type>(t);
             sg[uid].type = ntype;
             sg[uid].uid = uid;
             sg[uid].node = n;
             sg[uid].name = name;
             sg[uid].layer = 0;
-            plugins.create_fields(n,sg[uid].fields);
+            sg[uid].row = scene().field_store.add_row(n,uid);
+            plugins.create_fields(n,sg[uid].fields,scene().field_store);
+            index_node(uid);
+            invalidate_plan();
+            scene().events.topology_changed(uid,event::NodeAdded);
             // do the selection in a seperate command
             //node_selection.push_back(n); 
 
@@ -177,13 +339,46 @@ namespace feather
             return static_cast<int>(uid);
         };
 
-        /* Remove node from scenegraph */
+        /*
+         * Remove node from scenegraph
+         * The node's slot is kept empty for a later add_node() so the uids of
+         * the other nodes don't change. Only the node's own connections are
+         * looked at.
+         */
         void remove_node(const unsigned int uid, status& error) {
+            FSceneGraph& sg = scene().sg;
+            std::unique_lock<std::shared_timed_mutex> write(scene().lock);
+            if(!node_exist(uid)) {
+                error = status(FAILED,"no node to remove");
+                return;
+            }
+
+            // the nodes that read from this node will need to be updated
+            typedef boost::graph_traits<FSceneGraph>::out_edge_iterator OutConn;
+            std::pair<OutConn,OutConn> out = boost::out_edges(uid,sg);
+            for(;out.first!=out.second;++out.first) {
+                sg[*out.first].tfield->update = true;
+                sg[*out.first].tfield->connected = false;
+            }
+            boost::clear_out_edges(uid,sg);
+            boost::clear_in_edges(uid,sg);
+
              // this is currently needed to update sg
-            smg::Instance()->clear();
-            smg::Instance()->add_state(static_cast<selection::Type>(sg[0].type),0,sg[0].node);
-            boost::clear_vertex(uid,sg);
-            boost::remove_vertex(uid,sg);
+            scene().selection.clear();
+            scene().selection.add_state(static_cast<selection::Type>(sg[0].type),0,sg[0].node);
+
+            unindex_node(uid);
+
+            // the fields stay in the field store until a new node of the same type takes the row
+            scene().field_store.free_row(sg[uid].node,sg[uid].row);
+            sg[uid].fields.clear();
+            sg[uid].cache.reset();
+            sg[uid].name.clear();
+            sg[uid].removed = true;
+            scene().generation[uid]++;
+            scene().free_slots.push_back(uid);
+            invalidate_plan();
+            scene().events.topology_changed(uid,event::NodeRemoved);
         };
 
         /* This gets called when all the nodes have been updated.
@@ -191,14 +386,74 @@ namespace feather
          * glinfo
          */
         void nodes_updated() {
+            state::FState& cstate = scene().cstate;
             cstate.clear_uid_update();
         };
 
+
+        // DIRTY
+
+        /*
+         * During an incremental update a node's do_it is only called
+         * if the node is dirty. A node is dirty if it was flagged (new nodes
+         * start out dirty) or if any of it's fields have their update flag set,
+         * which happens when a field's value is set, when an input gets
+         * connected or when an upstream node was updated.
+         */
+        void set_update_mode(state::SGUpdate mode) { scene().cstate.sgUpdate = mode; };
+
+        state::SGUpdate get_update_mode() { return scene().cstate.sgUpdate; };
+
+        void mark_dirty(const unsigned int uid) { scene().sg[uid].dirty = true; };
+
+        bool node_dirty(const unsigned int uid) {
+            FSceneGraph& sg = scene().sg;
+            if(sg[uid].dirty)
+                return true;
+            for(auto f : sg[uid].fields) {
+                if(f->update)
+                    return true;
+            }
+            return false;
+        };
+
+        /*
+         * Called after the node's do_it. The targets of all the node's
+         * out connections get flagged so the downstream nodes will update
+         * and the node's own flags get cleared.
+         * The do_it wrote the node's outputs, they and the node get a new
+         * version. The outputs, and the inputs that were flagged, are sent
+         * to the event bus as written.
+         */
+        void node_updated(const unsigned int uid) {
+            Scene& s = scene();
+            FSceneGraph& sg = s.sg;
+            typedef boost::graph_traits<FSceneGraph>::out_edge_iterator OutConn;
+            std::pair<OutConn,OutConn> out = boost::out_edges(uid,sg);
+            for(;out.first!=out.second;++out.first)
+                sg[*out.first].tfield->update = true;
+
+            const uint64_t version = ++s.version;
+            sg[uid].version = version;
+            const bool publish = s.events.listening();
+            for(auto f : sg[uid].fields) {
+                const bool output = f->conn_type==field::connection::Out;
+                if(output)
+                    f->version = version;
+                // node fields only carry the connection, there's no value to look at
+                if(publish && f->type!=field::Node && (f->update || output))
+                    s.events.field_changed(uid,f->id,f->version);
+                f->update = false;
+            }
+            sg[uid].dirty = false;
+        };
+
         /*  Get Node Connections 
      *  will add all the nodes connected to the
      *  uid to the nodes reference
      */
     void get_node_out_connections(const unsigned int uid, std::vector<unsigned int>& uids) {
+        FSceneGraph& sg = scene().sg;
         typedef boost::graph_traits<FSceneGraph>::out_edge_iterator OutConn;
         std::pair<OutConn,OutConn> out = boost::out_edges(uid,sg);
 
@@ -217,32 +472,47 @@ namespace feather
      * Return a vector containing all the uids in the scenegraph
      */
     void get_nodes(std::vector<unsigned int> &uids) {
+        FSceneGraph& sg = scene().sg;
         int count = num_vertices(sg);
-        for(int i=0; i < count; i++)
-            uids.push_back(i);
+        for(int i=0; i < count; i++) {
+            if(!sg[i].removed)
+                uids.push_back(i);
+        }
     }
 
+    /* if more then one node has the name, the one with the highest uid is returned */
     void get_node_by_name(std::string name, unsigned int& uid) {
-        int count = num_vertices(sg);
-        for(int i=0; i < count; i++){
-            if(sg[i].name == name)
-                uid = i;
-        }
+        Scene& s = scene();
+        auto n = s.names.find(name);
+        if(n != s.names.end())
+            uid = *n->second.rbegin();
     }
 
     void get_node_by_type(node::Type type, std::vector<unsigned int>& uids) {
-        int count = num_vertices(sg);
-        for(int i=0; i < count; i++){
-            if(sg[i].type == type)
-                uids.push_back(i);
-        }
+        Scene& s = scene();
+        auto t = s.types.find(type);
+        if(t != s.types.end())
+            uids.insert(uids.end(),t->second.begin(),t->second.end());
     }
 
     void get_node_name(const unsigned int uid, std::string& name, status& error) {
+        FSceneGraph& sg = scene().sg;
         // TODO verify that uid exist and set the error if it doesn't
         name = sg[uid].name;
     };
 
+    status set_node_name(const unsigned int uid, const std::string name) {
+        FSceneGraph& sg = scene().sg;
+        std::unique_lock<std::shared_timed_mutex> write(scene().lock);
+        if(!node_exist(uid))
+            return status(FAILED,"no node to rename");
+        unindex_node(uid);
+        sg[uid].name = name;
+        index_node(uid);
+        scene().events.topology_changed(uid,event::Renamed);
+        return status();
+    };
+
 
     void get_node_icon(const unsigned int nid, std::string& file, status& error) {
         error = plugins.node_icon_file(nid,file);
@@ -250,12 +520,19 @@ namespace feather
 
 
     unsigned int get_node_id(const unsigned int uid, status& error) {
+        FSceneGraph& sg = scene().sg;
+        // the events can still name a node that was removed since
+        if(!node_exist(uid)) {
+            error = status(FAILED,"no node to get the id of");
+            return 0;
+        }
         return sg[uid].node;
     };
 
 
     /* This will return all the node uids connected to node */
     status get_node_connected_uids(int uid, std::vector<int>& uids) {
+        FSceneGraph& sg = scene().sg;
         typedef typename boost::graph_traits<FSceneGraph>::out_edge_iterator ei;
         std::pair<ei,ei> p = boost::out_edges(uid,sg);
 
@@ -272,6 +549,7 @@ namespace feather
 
     /* This will return all the node uids connected to node's fid */
     status get_node_connected_uids(int uid, int fid, std::vector<int>& uids) {
+        FSceneGraph& sg = scene().sg;
         typedef typename boost::graph_traits<FSceneGraph>::out_edge_iterator ei;
         std::pair<ei,ei> p = boost::out_edges(uid,sg);
 
@@ -283,9 +561,55 @@ namespace feather
         return status();
     };
 
+
+    /* This will return all the node uids that feed the node */
+    status get_node_input_uids(int uid, std::vector<int>& uids) {
+        FSceneGraph& sg = scene().sg;
+        if(!node_exist(uid))
+            return status(FAILED,"node doesn't exist");
+        typedef typename boost::graph_traits<FSceneGraph>::in_edge_iterator ei;
+        std::pair<ei,ei> p = boost::in_edges(uid,sg);
+
+        for(;p.first!=p.second;++p.first)
+            uids.push_back(source(*p.first,sg));
+
+        return status();
+    };
+
+
+    /* The source of the connection into the node's input fid, only the node's in edges are looked at */
+    status get_connected_fid(int uid, int fid, int& suid, int& sfid) {
+        FSceneGraph& sg = scene().sg;
+        if(node_exist(uid)) {
+            typedef typename boost::graph_traits<FSceneGraph>::in_edge_iterator ei;
+            std::pair<ei,ei> p = boost::in_edges(uid,sg);
+            for(;p.first!=p.second;++p.first){
+                if(sg[*p.first].f2 == fid) {
+                    suid = source(*p.first,sg);
+                    sfid = sg[*p.first].f1;
+                    return status();
+                }
+            }
+        }
+        // nothing is connected
+        suid=0;
+        sfid=0;
+        return status(FAILED,"nothing connected to node's fid");
+    };
+
+
+    /* true if the suid's sfid is connected to the tuid's tfid */
+    bool fields_connected(int suid, int sfid, int tuid, int tfid) {
+        int s,f;
+        if(get_connected_fid(tuid,tfid,s,f).state==FAILED)
+            return false;
+        return s==suid && f==sfid;
+    };
+
     
     /* return a description of how the node is to be draw, if at all */
     status get_node_draw_items(int nid, draw::DrawItems& items) {
+        // the items belong to the caller, they don't depend on the scene
         plugins.get_draw_items(nid,items);
         // TODO add a fail status if there is no draw call or failed to get the draw items
         return status();
@@ -295,37 +619,45 @@ namespace feather
     // FIELDS
 
 
+    /*!
+     * The fid of every node of the nid, in the order of the node's rows.
+     * It's empty if the nid doesn't have the fid or the fid's type isn't _Type.
+     * This is for code that works on the same field of many nodes at once,
+     * the column is good until the scene is cleared.
+     */
+    template <typename _Type>
+    field::Column<field::Field<_Type> > get_field_column(int nid, int fid) {
+        return scene().field_store.column<field::Field<_Type> >(nid,fid);
+    };
+
+
+    /*
+     * The node's field for the fid. The slot comes from the node type's
+     * table, which the plugin manager made when the plugin was loaded.
+     */
+    field::FieldBase* node_field(int uid, int fid) {
+        FNode& node = scene().sg[uid];
+        const int slot = plugins.field_slot(node.node,fid);
+        if(slot < 0 || static_cast<unsigned int>(slot) >= node.fields.size())
+            return nullptr;
+        return node.fields[slot];
+    };
+
+
     /*!
      * Returns a node's field that holds the value for the fid.
-     * NOTE! if the field is connected it will return the field of the parent that's connected to it.
-     * If you want to get the base of the node's fid, even if it's connected, use get_node_fieldBase().
+     * A connected input holds a copy of the value it's connected to, converted
+     * if the types are different. It's brought in when the connection is made
+     * and each time before the node runs, see FEvalPlan::pull_inputs().
+     * To get the field it's connected to use get_connected_fid().
      */
     field::FieldBase* get_fieldBase(int uid, int nid, int fid) {
-        field::FieldBase* f = plugins.get_fieldBase(uid,nid,fid,sg[uid].fields); 
-        std::cout << "CALLING get_fieldBase - uid:" << uid << " nid:" << nid << " fid:" << fid << " connected:" << f->connected << std::endl;
-        if(!f || f->connected) {
-            //f = sg[uid].fields.at(fid); // TODO fix this once the rest works!
-            //if(!f)
-            //    return nullptr;
-            //else
-            //    return f;
-            //}
-            if(f->connected){
-                std::cout << "field is connected to uid:" << f->puid << ", node:" << f->pn << ", field " << f->pf << std::endl;
-                f = get_fieldBase(f->puid,f->pn,f->pf);
-            //} else {
-                //std::cout << "field is not connected, returning the default field\n";
-            //    return f;
-            } 
-        }
-        return f;
+        return node_field(uid,fid);
     };
 
 
     /*!
-     * Returns a node's field that holds the value for the fid.
-     * NOTE! if the field is connected it will return the field of the parent that's connected to it.
-     * If you want to get the base of the node's fid, even if it's connected, use get_node_fieldBase().
+     * Returns a node's field that holds the value for the fid, see above.
      */
     field::FieldBase* get_fieldBase(int uid, int fid) {
         status e;
@@ -335,20 +667,10 @@ namespace feather
 
 
     /*!
-     * Same as get_fieldBase() except it will return the base of the node field even if it's connected 
+     * The node's own field for the fid, this is the same field get_fieldBase() returns
      */
     field::FieldBase* get_node_fieldBase(int uid, int nid, int fid) {
-        field::FieldBase* f = plugins.get_fieldBase(uid,nid,fid,sg[uid].fields); 
-        if(!f) {
-            for(auto field : sg[uid].fields){
-                //std::cout << "looking for " << fid << " field id=" << field->id << std::endl;
-                if(field->id == fid)
-                    f = field;
-            }
-            if(!f)
-                return nullptr;
-        }
-        return f;
+        return node_field(uid,fid);
     };
 
     field::FieldBase* get_node_fieldBase(int uid, int fid) {
@@ -358,58 +680,121 @@ namespace feather
     };
 
 
+    /*!
+     * Version of the value get_fieldBase() finds for the fid. It only goes
+     * up, so if it's the same as the last time it was read the value hasn't
+     * changed. 0 if the field was never written or doesn't exist.
+     */
+    uint64_t get_field_version(int uid, int fid) {
+        if(!node_exist(uid))
+            return 0;
+        field::FieldBase* f = get_fieldBase(uid,fid);
+        return (f) ? f->version : 0;
+    };
+
+    // version of the node's outputs, from it's last do_it
+    uint64_t get_node_version(int uid) {
+        return (node_exist(uid)) ? scene().sg[uid].version : 0;
+    };
+
+    // the latest version given out in the scene
+    uint64_t get_scene_version() { return scene().version.load(); };
+
+
+    /*!
+     * Read only view of the value that get_fieldBase() finds for the fid,
+     * nothing is copied. The view is empty if there is no such field or
+     * it doesn't hold a _Type. See field::FieldView for the locking.
+     */
+    template <typename _Type>
+    field::FieldView<_Type> get_field_view(int uid, int fid) {
+        typename field::FieldView<_Type>::Lock read(scene().lock);
+        if(!node_exist(uid))
+            return field::FieldView<_Type>();
+        field::FieldBase* f = get_fieldBase(uid,fid);
+        if(!f || !field::holds_type<_Type>(f))
+            return field::FieldView<_Type>();
+        return field::FieldView<_Type>(std::move(read),static_cast<field::Field<_Type>*>(f));
+    };
+
+
+    /*!
+     * Write a value into the field that get_fieldBase() finds for the fid
+     * from outside a do_it. The node is flagged to update and the write
+     * gets a version and an event, see field_written(). Fails if there is
+     * no such field or it doesn't hold a _Type.
+     */
+    template <typename _Type>
+    status set_field_value(int uid, int fid, const _Type& val) {
+        std::unique_lock<std::shared_timed_mutex> write(scene().lock);
+        if(!node_exist(uid))
+            return status(FAILED,"no node to set the field of");
+        field::FieldBase* f = get_fieldBase(uid,fid);
+        if(!f || !field::holds_type<_Type>(f))
+            return status(FAILED,"no field of the value's type");
+        static_cast<field::Field<_Type>*>(f)->value = val;
+        f->update = true;
+        field_written(uid,fid,f);
+        return status();
+    };
+
+
     int get_field_count(int uid) {
+        FSceneGraph& sg = scene().sg;
         return sg[uid].fields.size(); 
     }
 
     int get_in_field_count(int uid) {
+        FSceneGraph& sg = scene().sg;
         int i=0;
         std::for_each(sg[uid].fields.begin(), sg[uid].fields.end(),[&i](field::FieldBase* f){ if(f->conn_type==field::connection::In){i++;} });
         return i; 
     }
 
     int get_out_field_count(int uid) {
+        FSceneGraph& sg = scene().sg;
         int i=0;
         std::for_each(sg[uid].fields.begin(), sg[uid].fields.end(),[&i](field::FieldBase* f){ if(f->conn_type==field::connection::Out){i++;} });
         return i; 
     }
 
     status get_in_fields(int uid, std::vector<unsigned int> &fids) {
+         FSceneGraph& sg = scene().sg;
          std::for_each(sg[uid].fields.begin(), sg[uid].fields.end(),[&fids](field::FieldBase* f){ if(f->conn_type==field::connection::In){fids.push_back(f->id);} });
          return status(); // need to test if the uid exist
     }
 
     status get_out_fields(int uid, std::vector<unsigned int> &fids) {
+         FSceneGraph& sg = scene().sg;
          std::for_each(sg[uid].fields.begin(), sg[uid].fields.end(),[&fids](field::FieldBase* f){ if(f->conn_type==field::connection::Out){fids.push_back(f->id);} });
          return status(); // need to test if the uid exist
     }
 
     field::connection::Type get_field_connection_type(int uid, int fid) {
-        for(uint i=0; i < sg[uid].fields.size(); i++){
-            if(sg[uid].fields.at(i)->id==fid)
-                return static_cast<field::connection::Type>(sg[uid].fields.at(i)->conn_type);
-        }
-        //std::for_each(sg[uid].fields.begin(), sg[uid].fields.end(),[&fid](field::FieldBase* f){ if(f->id==fid){ return f->conn_type; } });
+        field::FieldBase* f = node_field(uid,fid);
+        if(f)
+            return static_cast<field::connection::Type>(f->conn_type);
         return static_cast<field::connection::Type>(0); // this should never be returned
-        
     }
 
 
     // LAYER
     
-    int layer_count() { return layers.size(); };
+    int layer_count() { return scene().layers.size(); };
 
-    FLayer* layer(int lid) { return &layers.at(lid); };
+    FLayer* layer(int lid) { return &scene().layers.at(lid); };
 
-    bool layer(int lid, FLayer& l) { l=layers.at(lid); return true; };
+    bool layer(int lid, FLayer& l) { l=scene().layers.at(lid); return true; };
 
-    FLayer* node_layer(int uid) { return &layers.at(sg[uid].layer); };
+    FLayer* node_layer(int uid) { return &scene().layers.at(scene().sg[uid].layer); };
 
     void set_layer(int uid, int layer) {
+        FSceneGraph& sg = scene().sg;
         sg[uid].layer = layer;
     };
 
     bool remove_layer(int lid) {
+        std::vector<FLayer>& layers = scene().layers;
         if(lid>=(int)layers.size() || lid==0)
             return false;
 
@@ -418,6 +803,7 @@ namespace feather
     };
 
     void move_layer(int sid, int tid) {
+        std::vector<FLayer>& layers = scene().layers;
         // check
         if(sid < 0 || sid >= (int)layers.size() || tid < 0 || tid >= (int)layers.size() || sid == tid)
             return;
@@ -433,62 +819,73 @@ namespace feather
         }
     }
 
-    void add_layer(FLayer layer) { layers.push_back(layer); };
+    void add_layer(FLayer layer) { scene().layers.push_back(layer); };
 
     void add_layer(std::string _name, FColorRGB _color=FColorRGB(1,1,1), bool _visible=true, bool _locked=false) {
+        std::vector<FLayer>& layers = scene().layers;
         layers.push_back(FLayer(_name,_color,_visible,_locked));
     };
 
     FLayer get_layer(int uid) {
+        FSceneGraph& sg = scene().sg;
+        std::vector<FLayer>& layers = scene().layers;
         return layers.at(sg[uid].layer);
     };
 
     void add_node_to_layer(int uid, int lid) {
+        FSceneGraph& sg = scene().sg;
         sg[uid].layer=lid;
     }
 
     // SELECTION
 
     int get_selected_node() {
-        if(smg::Instance()->count()>0)
-            return smg::Instance()->get_uid(smg::Instance()->count()-1);
+        if(scene().selection.count()>0)
+            return scene().selection.get_uid(scene().selection.count()-1);
         else 
             return -1; // nothing selected
     };
 
     status add_selection(int uid) {
-        smg::Instance()->add_state(static_cast<selection::Type>(sg[uid].type),uid,sg[uid].node);
+        FSceneGraph& sg = scene().sg;
+        scene().selection.add_state(static_cast<selection::Type>(sg[uid].type),uid,sg[uid].node);
         return status();
     };
 
     status add_selection(int type, int uid) {
-        smg::Instance()->add_state(static_cast<selection::Type>(type),uid,sg[uid].node);
+        FSceneGraph& sg = scene().sg;
+        scene().selection.add_state(static_cast<selection::Type>(type),uid,sg[uid].node);
         return status();
     };
 
     status add_selection(int type, int uid, int nid) {
         // status was returned here because we'll probably use it later
-        smg::Instance()->add_state(static_cast<selection::Type>(type),uid,nid,0);
+        scene().selection.add_state(static_cast<selection::Type>(type),uid,nid,0);
         return status();
     };
 
     status add_selection(int type, int uid, int nid, int fid) {
         // status was returned here because we'll probably use it later
-        smg::Instance()->add_state(static_cast<selection::Type>(type),uid,nid,fid);
+        scene().selection.add_state(static_cast<selection::Type>(type),uid,nid,fid);
         return status();
     };
 
     void clear_selection() {
-        smg::Instance()->clear();
+        scene().selection.clear();
+    };
+
+    bool node_selected(int uid) {
+        return scene().selection.selected(uid);
     };
 
     status get_selected_nodes(std::vector<int>& uids) {
-        for(uint i=0; i < smg::Instance()->count(); i++)
-            uids.push_back(smg::Instance()->get_uid(i));
+        for(uint i=0; i < scene().selection.count(); i++)
+            uids.push_back(scene().selection.get_uid(i));
         return status();
     };
 
     status get_fid_list(int uid, int nid, field::connection::Type conn, std::vector<field::FieldBase*>& list) {
+        FSceneGraph& sg = scene().sg;
         return plugins.get_fid_list(nid,conn,sg[uid].fields,list);
     }
 
@@ -536,285 +933,488 @@ namespace feather
     template <int _Type> struct do_it<_Type,-1> { static status exec(FNodeDescriptor node) { return status(FAILED, "no node do_it found"); }; };
     */
 
-} // namespace scenegraph
 
-class node_visitor : public boost::default_bfs_visitor
-{
-    public:
-        //typedef boost::on_finish_vertex event_filter;
+    /*!
+     * Build the evaluation plan. This is only done when the plan is invalid,
+     * which happens when nodes are added or removed or when connections change.
+     * The steps follow the scene's topological order which connect() keeps
+     * up to date, so every node comes after all the nodes that feed it.
+     * Only the nodes that can be reached from the root get into the plan.
+     */
+    status build_plan()
+    {
+        FSceneGraph& sg = scene().sg;
+        FEvalPlan& eval_plan = scene().eval_plan;
+        const GraphSnapshot& graph = snapshot();
+        typedef boost::graph_traits<FSceneGraph>::in_edge_iterator InConn;
+        eval_plan.steps.clear();
+        eval_plan.levels.clear();
+        eval_plan.succ_offsets.clear();
+        eval_plan.succ.clear();
+        eval_plan.indegree.clear();
+        eval_plan.position.clear();
+        eval_plan.input_offsets.clear();
+        eval_plan.inputs.clear();
+        eval_plan.valid = true;
+
+        if(!num_vertices(sg))
+            return status();
+
+        // a node's level is one more than the highest level feeding it
+        std::vector<char> reached(num_vertices(sg),0);
+        std::vector<unsigned int> level(num_vertices(sg),0);
+        unsigned int max_level=0;
+        reached[0] = 1;
+        for(unsigned int n : scene().order.nodes()) {
+            if(!reached[n])
+                continue;
+
+            FEvalStep step(n,sg[n].node,&sg[n].fields);
+            step.level = level[n];
+            max_level = std::max(max_level,step.level);
+            eval_plan.steps.push_back(step);
+
+            for(const FSnapshotEdge& e : graph.out_edges(n)) {
+                reached[e.uid] = 1;
+                level[e.uid] = std::max(level[e.uid],step.level+1);
+            }
+        }
 
-        /*
-         *  The order of update for a graph like this:
-         *      A
-         *     / \
-         *  ->B-->C
-         *  |  \ /
-         *  ----D
-         *
-         *  would be this: 
-         *      init vertex A // do any setup that is needed for the node
-         *      init vertex B
-         *      init vertex C
-         *      init vertex D
-         *      discover vertex A // discover will call the parent and it's children nodes
-         *      examine edge A->B // send the field value to the target node's fields - this will probably not be needed since the target will just hold a pointer to the source field  
-         *      tree edge A->B
-         *      discover vertex B
-         *      examine edge A->C
-         *      tree edge A->C
-         *      discover vertex C
-         *      finish vertex A // call the nodes do_it() 
-         *      examine edge A->B
-         *      examine edge B->C
-         *      examine edge B->D
-         *      tree edge B->D
-         *      discover vertex D
-         *      examine edge D->B
-         *      finish vertex B
-         *      examine edge A->C
-         *      examine edge B->C
-         *      examine edge C->D
-         *      finish vertex C
-         *      examine edge B->D
-         *      examine edge C->D
-         *      examine edge D->B
-         *      finish vertex D
-         */
+        // keep the topological order inside of each level
+        std::stable_sort(eval_plan.steps.begin(), eval_plan.steps.end(), [](const FEvalStep& a, const FEvalStep& b){ return a.level < b.level; });
+
+        eval_plan.levels.assign(max_level+2,0);
+        for(const FEvalStep& step : eval_plan.steps)
+            eval_plan.levels[step.level+1]++;
+        for(unsigned int i=1; i < eval_plan.levels.size(); i++)
+            eval_plan.levels[i] += eval_plan.levels[i-1];
+
+        // the task graph used by the Tasks schedule
+        eval_plan.position.assign(num_vertices(sg),-1);
+        for(unsigned int i=0; i < eval_plan.steps.size(); i++)
+            eval_plan.position[eval_plan.steps[i].uid] = i;
+
+        eval_plan.indegree.assign(eval_plan.steps.size(),0);
+        eval_plan.succ_offsets.reserve(eval_plan.steps.size()+1);
+        for(const FEvalStep& step : eval_plan.steps) {
+            eval_plan.succ_offsets.push_back(eval_plan.succ.size());
+            for(const FSnapshotEdge& e : graph.out_edges(step.uid)) {
+                unsigned int t = eval_plan.position[e.uid];
+                eval_plan.succ.push_back(t);
+                eval_plan.indegree[t]++;
+            }
+        }
+        eval_plan.succ_offsets.push_back(eval_plan.succ.size());
 
-        /*
-         * The way node fields are handled are like this:
-         *  ________                ________
-         * | NODE A |  bgl edge    | NODE B |
-         * |        |------------->|        |
-         * |________|              |________|
-         *
-         * When a node is adjusted it will call Boost::BGL and tell
-         * it that it has changed and to start the update at that node.
-         * BGL will first call all the node::init() functions for
-         * every node connected to the start node.
-         * Then the graph walking begins.
-         *      1: the node::discover() gets called for parent node followed by:
-         *              node::examine() [parent to child]
-         *              node::tree() [parent to child]
-         *              node::discover() [child node]
-         *              {THE ABOVE THREE STEPS ARE REPEATED FOR EACH CHILD}
-         *      2: the node::do_it() for the parent is called since everything is safe for it to update
-         *      3: move on to the next child node and repeat steps 1 and 2
-         *
-         * The opengl update is done the same except it always starts at
-         * the root node and node::finish() is where the specialized draw()
-         * function will be found.
-         *
-         * To handle these different states the scenegraph holds a State value
-         * that will tell wheither the graph is in UPDATE, DRAW, or RENDER.
-         *
-         */
+        // the inputs each step pulls before it runs
+        auto slot = [](const field::Fields& fields, field::FieldBase* f){
+            return static_cast<unsigned int>(std::find(fields.begin(),fields.end(),f) - fields.begin());
+        };
+        eval_plan.input_offsets.reserve(eval_plan.steps.size()+1);
+        for(const FEvalStep& step : eval_plan.steps) {
+            eval_plan.input_offsets.push_back(eval_plan.inputs.size());
+            std::pair<InConn,InConn> in = boost::in_edges(step.uid,sg);
+            for(;in.first!=in.second;++in.first) {
+                const FConnection& c = sg[*in.first];
+                if(!c.pull)
+                    continue;
+                const unsigned int src = boost::source(*in.first,sg);
+                FEvalInput input;
+                input.pull = c.pull;
+                input.src = c.sfield;
+                input.step = eval_plan.position[src];
+                input.src_slot = slot(sg[src].fields,c.sfield);
+                input.dst_slot = slot(*step.fields,c.tfield);
+                eval_plan.inputs.push_back(input);
+            }
+        }
+        eval_plan.input_offsets.push_back(eval_plan.inputs.size());
 
-        /*
-         * Update Process:
-         */
+        return status();
+    };
 
-        // VERTEX
 
+    // NODE CACHE
 
-        // Init Vertex
-        /*
-         * This gets called by all vertex at the beginning of an update.
-         */
-        template < typename Vertex, typename Graph >
-            void initialize_vertex(Vertex u, const Graph & g) const
-            {
-                std::cout << "init nid " << sg[u].node << std::endl;
-            }
+    /*!
+     * Turn on the node's output cache, keeping the outputs of the last
+     * `size` different inputs. A size of 0 turns the cache off.
+     * Only turn this on for nodes whose outputs depend on nothing but their In fields.
+     */
+    status set_node_cache(int uid, unsigned int size)
+    {
+        std::unique_lock<std::shared_timed_mutex> write(scene().lock);
+        if(!node_exist(uid))
+            return status(FAILED,"no node to cache");
+        FSceneGraph& sg = scene().sg;
+        if(!size)
+            sg[uid].cache.reset();
+        else if(!sg[uid].cache)
+            sg[uid].cache = std::make_shared<cache::NodeCache>(size);
+        else
+            sg[uid].cache->resize(size);
+        return status();
+    };
 
-        // Start Vertex
-        /*
-         * This should be called by the source vertex at the start but I haven't seen it yet.
-         */
-        template < typename Vertex, typename Graph >
-            void start_vertex(Vertex u, const Graph & g) const
-            {
-                std::cout << "start nid " << sg[u].node << std::endl;
+    status get_node_cache_stats(int uid, unsigned int& hits, unsigned int& misses)
+    {
+        std::shared_lock<std::shared_timed_mutex> read(scene().lock);
+        FSceneGraph& sg = scene().sg;
+        hits=0;
+        misses=0;
+        if(!node_exist(uid))
+            return status(FAILED,"no node to get the cache stats of");
+        if(!sg[uid].cache)
+            return status(FAILED,"node is not cached");
+        hits = sg[uid].cache->hits();
+        misses = sg[uid].cache->misses();
+        return status();
+    };
+
+    /*!
+     * The cache key of the plan's step i. Scalar inputs hash their value,
+     * connected ones after it was pulled, so the node hits again when an
+     * upstream node gives the same value. Bigger values are never read,
+     * a connected one is keyed on the upstream node and the version of the
+     * field it pulls from and an unconnected one on it's own version, they
+     * only change through the scenegraph. Returns false if an input can't be keyed.
+     */
+    bool inputs_key(unsigned int i, uint64_t& key)
+    {
+        const FEvalPlan& plan = scene().eval_plan;
+        const field::Fields& fields = *plan.steps[i].fields;
+        key = 14695981039346656037ULL;
+        for(unsigned int n=plan.input_offsets[i]; n < plan.input_offsets[i+1]; n++) {
+            const FEvalInput& in = plan.inputs[n];
+            field::FieldBase* f = fields[in.dst_slot];
+            field::hash_value(f->id,key);
+            if(field::is_scalar(f->type)) {
+                if(!field::hash_field(f,key))
+                    return false;
+                continue;
             }
+            field::hash_value(f->puid,key);
+            field::hash_value(in.src->id,key);
+            field::hash_value(in.src->version,key);
+        }
+        for(field::FieldBase* f : fields) {
+            if(f->conn_type != field::connection::In)
+                continue;
+            // node fields carry the connection, the others were keyed above
+            if(f->connected && f->type != field::Node)
+                continue;
+            field::hash_value(f->id,key);
+            if(f->type == field::Node || field::is_scalar(f->type)) {
+                if(!field::hash_field(f,key))
+                    return false;
+            }
+            else
+                field::hash_value(f->version,key);
+        }
+        return true;
+    };
 
-        // Discover Vertex
-        /*
-         * This gets called each time a vertex is encountered
-         */
-        template < typename Vertex, typename Graph >
-            void discover_vertex(Vertex u, const Graph & g) const
-            {
-                std::cout << "discover vertex(uid):" << u << " nid:" << sg[u].node << std::endl;
-                //scenegraph::do_it<node::N>::exec(u);
+    /*!
+     * Pull the inputs of the plan's step i and call the node's do_it, or
+     * restore it's outputs from the node's cache if it has already seen
+     * the same inputs, see inputs_key().
+     */
+    void run_node(unsigned int i)
+    {
+        FSceneGraph& sg = scene().sg;
+        const FEvalPlan& plan = scene().eval_plan;
+        const FEvalStep& step = plan.steps[i];
+        plan.pull_inputs(i,[](const FEvalInput& in){ return in.src; },*step.fields);
+        cache::NodeCache* c = sg[step.uid].cache.get();
+        if(!c) {
+            plugins.do_it(step.nid,*step.fields);
+            return;
+        }
 
-                status p = plugins.do_it(sg[u].node,sg[u].fields);
+        uint64_t key;
+        if(!inputs_key(i,key)) {
+            c->miss();
+            plugins.do_it(step.nid,*step.fields);
+            return;
+        }
 
-                /* 
-                if(cstate.sgMode==state::DoIt)
-                {
-                    status p = plugins.do_it(sg[u].node,sg[u].fields);
-                    if(!p.state)
-                        std::cout << "NODE FAILED! : \"" << p.msg << "\"\n";
-                }
-                */
-
-                /*
-                if(cstate.sgMode==state::DrawIt)
-                {
-                    status p = plugins.draw_it(sg[u].node,sg[u].items);
-                    if(!p.state)
-                        std::cout << "NODE FAILED! : \"" << p.msg << "\"\n";
-                }
-                */
-
-                // This might still come in handy later on
-                /*
-                switch(sg[u].type)
-                {
-                    case node::Null:
-                        scenegraph::do_it<node::Null,null::N>::exec(u);
-                        break;
-                    case node::Camera:
-                        scenegraph::do_it<node::Camera,camera::N>::exec(u);
-                        break;
-                    case node::Light:
-                        scenegraph::do_it<node::Light,light::N>::exec(u);
-                        break;
-                    case node::Texture:
-                        scenegraph::do_it<node::Texture,texture::N>::exec(u);
-                        break;
-                    case node::Shader:
-                        scenegraph::do_it<node::Shader,shader::N>::exec(u);
-                        break;
-                    case node::Object:
-                        scenegraph::do_it<node::Object,object::N>::exec(u);
-                        break;
-                    default:
-                        break;
+        if(c->restore(key,*step.fields))
+            return;
+
+        plugins.do_it(step.nid,*step.fields);
+        c->store(key,*step.fields);
+    };
+
+
+    /*!
+     * Set the number of worker threads used by the Levels and Tasks schedules.
+     * With 0 workers the calling thread updates every node.
+     */
+    void set_thread_count(unsigned int threads) { scene().eval_pool.resize(threads); };
+
+    unsigned int get_thread_count() { return scene().eval_pool.size(); };
+
+    void set_schedule(state::SGSchedule schedule) { scene().cstate.sgSchedule = schedule; };
+
+    state::SGSchedule get_schedule() { return scene().cstate.sgSchedule; };
+
+
+    /*!
+     * True if an incremental update would have something to do, the
+     * topology changed since the plan was built or a node in the plan is dirty.
+     */
+    bool needs_update()
+    {
+        Scene& s = scene();
+        std::shared_lock<std::shared_timed_mutex> read(s.lock);
+        if(!s.eval_plan.valid)
+            return true;
+        for(const FEvalStep& step : s.eval_plan.steps) {
+            if(node_dirty(step.uid))
+                return true;
+        }
+        return false;
+    };
+
+    /*!
+     * Update all the scenegraph nodes in the order of the evaluation plan.
+     * In Incremental mode only the dirty nodes are updated.
+     * In the Levels and Tasks schedules node do_its are called in parallel,
+     * so a node's do_it must only write to it's own fields.
+     */
+    status update()
+    {
+        Scene& s = scene();
+        std::unique_lock<std::shared_timed_mutex> write(s.lock);
+        state::FState& cstate = s.cstate;
+        FEvalPlan& eval_plan = s.eval_plan;
+        ThreadPool& eval_pool = s.eval_pool;
+        status p;
+        if(!eval_plan.valid)
+            p = build_plan();
+
+        const bool incremental = cstate.sgUpdate==state::Incremental;
+
+        if(cstate.sgSchedule==state::Tasks) {
+            TaskScheduler scheduler(eval_pool);
+            scheduler.run(eval_plan.indegree,eval_plan.succ_offsets,eval_plan.succ,[&s,&eval_plan,incremental](unsigned int i){
+                    // the workers have to update the nodes of this scene
+                    SceneScope scope(s);
+                    const FEvalStep& step = eval_plan.steps[i];
+                    if(incremental && !node_dirty(step.uid))
+                        return;
+                    run_node(i);
+                    // the nodes fed by this one have not started yet
+                    node_updated(step.uid);
+                    });
+            return p;
+        }
+
+        if(cstate.sgSchedule==state::Levels) {
+            std::vector<char> ran;
+            for(unsigned int l=0; l+1 < eval_plan.levels.size(); l++) {
+                const unsigned int first = eval_plan.levels[l];
+                const unsigned int count = eval_plan.levels[l+1] - first;
+                ran.assign(count,0);
+
+                eval_pool.run(count,[&s,&eval_plan,first,incremental,&ran](unsigned int i){
+                        SceneScope scope(s);
+                        const FEvalStep& step = eval_plan.steps[first+i];
+                        if(incremental && !node_dirty(step.uid))
+                            return;
+                        run_node(first+i);
+                        ran[i] = 1;
+                        });
+
+                // flag the next levels once every node in this level is done
+                for(unsigned int i=0; i < count; i++) {
+                    if(ran[i])
+                        node_updated(eval_plan.steps[first+i].uid);
                 }
-                */
             }
+            return p;
+        }
 
-        // Finish Vertex
-        /*
-         * This gets called each time a vertex's child vertex are finished
-         */
-        template < typename Vertex, typename Graph >
-            void finish_vertex(Vertex u, const Graph & g) const
-            {
-                std::cout << "finish vertex(uid) " << sg[u].node << std::endl;
-            }
+        for(unsigned int i=0; i < eval_plan.steps.size(); i++) {
+            const FEvalStep& step = eval_plan.steps[i];
+            // nothing feeding this node has changed
+            if(incremental && !node_dirty(step.uid))
+                continue;
 
-        // EDGES
+            run_node(i);
+            node_updated(step.uid);
+        }
 
-        // Examine Edge
-        /*
-         * This gets called after a vertex has been discovered and after a node has finished
-         */
-        template < typename Edge, typename Graph >
-            void examine_edge(Edge u, const Graph & g) const
-            {
-                std::cout << "examine edge - uid1:" << sg[u].n1 
-                    << " fid1:" << sg[u].f1
-                    << " uid2:" << sg[u].n2
-                    << " fid2:" << sg[u].f2
-                    << std::endl;
-            }
+        return p;
+    };
 
 
+    /*!
+     * Evaluate the scene at each frame from start to end, stepping by step,
+     * by setting the time field (tuid,tfid) and running every node in the plan.
+     * The frames are spread over as many threads as the update uses, each working
+     * on it's own FrameView, and the scene itself is left as it was.
+     * The scene is only locked while the views copy it's fields, the frames are
+     * worked out on the copies so the scene can be read and changed meanwhile.
+     * frames gets a copy of the output fields' values for each frame.
+     */
+    status evaluate_frames(int tuid, int tfid, FReal start, FReal end, FReal step, const std::vector<FFieldId>& outputs, std::vector<FFrame>& frames)
+    {
+        Scene& s = scene();
+        frames.clear();
 
-        // Tree Edge
-        /*
-         * This gets called each after the examine edge and only for edges that will make a tree
-         * This would be used to draw the Outliner graph
-         */
-        template < typename Edge, typename Graph >
-            void tree_edge(Edge u, const Graph & g) const
-            {
-                std::cout << "tree edge - uid1:" << sg[u].n1 
-                    << " fid1:" << sg[u].f1
-                    << " uid2:" << sg[u].n2
-                    << " fid2:" << sg[u].f2
-                    << std::endl;
-            }
+        if(step <= 0 || end < start)
+            return status(FAILED,"invalid frame range");
 
-        // Forward or Cross  Edge
-        /*
-         * This should be called in forward or cross edges but I never saw it. 
-         */
-        template < typename Edge, typename Graph >
-            void forward_or_cross_edge(Edge u, const Graph & g) const
-            {
-                std::cout << "forward or cross edge nid:" << sg[u].node << std::endl;
+        // the views need the scene's plan and fields, the lock is only taken alone if the plan has to be rebuilt
+        FEvalPlan plan;
+        std::vector<std::unique_ptr<FrameView> > views;
+        const unsigned int threads = s.eval_pool.size();
+        status p;
+        {
+            std::shared_lock<std::shared_timed_mutex> read(s.lock);
+            std::unique_lock<std::shared_timed_mutex> write(s.lock,std::defer_lock);
+            if(!s.eval_plan.valid) {
+                read.unlock();
+                write.lock();
             }
 
+            field::FieldBase* time = (node_exist(tuid)) ? get_node_fieldBase(tuid,tfid) : nullptr;
+            if(!time)
+                return status(FAILED,"no time field found");
+            if(time->type!=field::Int && time->type!=field::Float && time->type!=field::Double && time->type!=field::Real)
+                return status(FAILED,"time field needs to be a number");
 
-};
+            if(!s.eval_plan.valid)
+                p = build_plan();
 
+            plan = s.eval_plan;
+            for(unsigned int i=0; i <= threads; i++)
+                views.push_back(std::unique_ptr<FrameView>(new FrameView(plan,time)));
+        }
 
-namespace scenegraph
-{
+        const unsigned int count = static_cast<unsigned int>((end-start)/step + 1e-6) + 1;
+        frames.reserve(count);
+        for(unsigned int i=0; i < count; i++)
+            frames.push_back(FFrame(start+step*i));
+
+        // the scene's pool belongs to update(), which can run while the frames are worked out
+        ThreadPool pool(threads);
+        std::atomic<unsigned int> next(0);
+        pool.run(views.size(),[&views,&frames,&outputs,&next](unsigned int t){
+                FrameView& view = *views[t];
+                unsigned int i;
+                while((i = next.fetch_add(1)) < frames.size()) {
+                    view.set_time(frames[i].time);
+                    view.run(plugins);
+                    for(const FFieldId& id : outputs) {
+                        field::FieldBase* f = view.get_field(id.uid,id.fid);
+                        field::FieldBase* v = (f) ? field::clone_field(f) : nullptr;
+                        if(v)
+                            frames[i].values.push_back(std::shared_ptr<field::FieldBase>(v,field::delete_field));
+                        else
+                            frames[i].values.push_back(std::shared_ptr<field::FieldBase>());
+                    }
+                }
+                });
+
+        return p;
+    };
+
+
+    // PULL
+
+    void set_evaluate_mode(state::SGEvaluate mode) { scene().cstate.sgEvaluate = mode; };
+
+    state::SGEvaluate get_evaluate_mode() { return scene().cstate.sgEvaluate; };
 
     /*!
-     * Update all the scenegraph based on the current state mode.
-     * State Modes = { None, DoIt, DrawIt, DrawGL, DrawSelection } 
+     * Update the node and every node upstream of it, which are found by following
+     * the connections of the In fields. Nothing downstream or on other branches
+     * gets updated.
+     * In Incremental mode only the dirty nodes of the upstream cone are updated.
      */
-    status update()
+    status evaluate(int uid)
     {
-        // Temporary turn off do_it updating for testing
-        // set the state node update 
-        //cstate.sgMode = state::DoIt;
+        Scene& s = scene();
+        std::unique_lock<std::shared_timed_mutex> write(s.lock);
+        if(!node_exist(uid))
+            return status(FAILED,"no node found to evaluate");
+
+        status p;
+        if(!s.eval_plan.valid)
+            p = build_plan();
+        const GraphSnapshot& graph = snapshot();
+
+        // plan steps of the upstream cone
+        std::vector<char> seen(num_vertices(s.sg),0);
+        std::vector<int> stack(1,uid);
+        std::vector<unsigned int> steps;
+        seen[uid] = 1;
+        while(!stack.empty()) {
+            int n = stack.back();
+            stack.pop_back();
+            if(s.eval_plan.position[n] >= 0)
+                steps.push_back(s.eval_plan.position[n]);
+            for(const FSnapshotEdge& e : graph.in_edges(n)) {
+                if(!seen[e.uid]) {
+                    seen[e.uid] = 1;
+                    stack.push_back(e.uid);
+                }
+            }
+        }
+        std::sort(steps.begin(),steps.end());
+
+        const bool incremental = s.cstate.sgUpdate==state::Incremental;
+        for(unsigned int i : steps) {
+            const FEvalStep& step = s.eval_plan.steps[i];
+            if(incremental && !node_dirty(step.uid))
+                continue;
+            run_node(i);
+            node_updated(step.uid);
+        }
 
-        node_visitor vis;
-        //node_d_visitor vis;
-        std::cout << "\n*****GRAPH UPDATE*****\n";
-        /*
-        std::cout << "Currently in the ";
-        switch(cstate.sgMode)
-        {
-            case state::None:
-                std::cout << "None";
-                break;
-            case state::DoIt:
-                std::cout << "DoIt";
-                break;
-            case state::DrawIt:
-                std::cout << "DrawIt";
-                break;
-            case state::DrawGL:
-                std::cout << "DrawGL";
-                break;
-            case state::DrawSelection:
-                std::cout << "DrawSelection";
-                break;
-            default:
-                std::cout << "Unknown";
-                break;
-        }
-        std::cout << " state\n";
-        */
-        breadth_first_search(sg, vertex(0, sg), visitor(vis));
-        //FNodeDescriptor s = vertex(0, scenegraph);
-           
-           //dijkstra_shortest_paths(scenegraph, s,
-           //predecessor_map(boost::make_iterator_property_map(p.begin(),
-           //get(boost::vertex_index, scenegraph))).distance_map(boost::make_iterator_property_map(d.begin(),
-           //get(boost::vertex_index, scenegraph))));
-        std::cout << "*****UPDATE COMPLETE*****\n";
+        return p;
+    };
 
-        return status();
+    /*!
+     * Update what the field depends on and return the field that holds it's value,
+     * same as get_fieldBase().
+     */
+    field::FieldBase* evaluate(int uid, int fid)
+    {
+        if(evaluate(uid).state==FAILED)
+            return nullptr;
+        return get_fieldBase(uid,fid);
     };
 
 
     /*!
      * Connect two node fields together.
-     * For these fields to be connected they need to be of the same type and not in the same node.
+     * For these fields to be connected field::connection_kind() has to allow their types and they can't be in the same node.
+     * The source's value is copied into the input before the node runs, or converted if the types are different.
      * If the input field already has a connection, it's input connection will be deleted and
      * replaced with a new between the passed fields
+     * verbose prints what's being connected, it's turned off for batches.
      */
-    status connect(FNodeDescriptor n1, int f1, FNodeDescriptor n2, int f2)
+    status make_connection(FNodeDescriptor n1, int f1, FNodeDescriptor n2, int f2, bool verbose);
+
+    status connect(FNodeDescriptor n1, int f1, FNodeDescriptor n2, int f2, bool verbose=true)
     {
-        std::cout << "Trying to connect nid: " << n1 << " fid: " << f1 << " to nid: " << n2 << " fid: " << f2 << std::endl;
+        std::unique_lock<std::shared_timed_mutex> write(scene().lock);
+        return make_connection(n1,f1,n2,f2,verbose);
+    };
+
+    // connect() for callers that already hold the scene's write lock
+    status make_connection(FNodeDescriptor n1, int f1, FNodeDescriptor n2, int f2, bool verbose)
+    {
+        Scene& s = scene();
+        FSceneGraph& sg = s.sg;
+        if(verbose)
+            std::cout << "Trying to connect nid: " << n1 << " fid: " << f1 << " to nid: " << n2 << " fid: " << f2 << std::endl;
+
+        if(!node_exist(n1) || !node_exist(n2))
+            return status(FAILED,"Can't connect nodes, no node found");
 
         // can't connect two fields from the same node
         if(n1==n2)
@@ -831,7 +1431,8 @@ namespace scenegraph
         if(!tfield)
             return status(FAILED,"Can't connect nodes, no target field found");
 
-        std::cout 
+        if(verbose)
+            std::cout 
             << "*** CONNECT NODES *** sconn_type=" << sfield->conn_type
             << ", tconn_type=" << tfield->conn_type
             << ", sn=" << src_node 
@@ -844,46 +1445,75 @@ namespace scenegraph
 
         // verify the the n1's fid is an output and n2's fid is an input
         if(sfield->conn_type != field::connection::Out || tfield->conn_type != field::connection::In){
-            std::cout << "could not connect - not OUT -> IN\n";
+            if(verbose)
+                std::cout << "could not connect - not OUT -> IN\n";
             return status(FAILED,"Mismatched connection types");
         }
 
         // can the fields be connected
-        if(!field::can_types_connect<field::START,field::START>::exec(sfield->type,tfield->type)){
-             std::cout << "could not connect - mismatched field types\n";
+        if(!field::can_types_connect(sfield->type,tfield->type)){
+             if(verbose)
+                 std::cout << "could not connect - mismatched field types\n";
              return status(FAILED,"Field's types mismatched - could not connect");
         }
 
-        // is the input field already connected to something else
-        //if(tfield->connected){
-            typedef typename boost::graph_traits<FSceneGraph>::out_edge_iterator ei;
-            std::pair<ei,ei> p = boost::out_edges(n2,sg);
-
-            //std::cout << "TEST edge iter " << *p.first << std::endl;
+        // a value with no kernel to pull it would never get to the input, node fields only carry the connection
+        if(sfield->type != field::Node && !field::converter(sfield->type,tfield->type)) {
+             if(verbose)
+                 std::cout << "could not connect - no way to pull the field's value\n";
+             return status(FAILED,"Field's value can't be pulled - could not connect");
+        }
 
-            for(;p.first!=p.second;++p.first){
-                std::cout << "edge iter " << *p.first << " fid1:" << sg[*p.first].f1  << " fid2:" << sg[*p.first].f2 << std::endl;
-                //uids.push_back(target(*p.first,sg));
-            }
+        // reject the connection if n2 already feeds n1 and keep the order up to date
+        bool ordered = scene().order.add_edge(n1,n2,
+                [&sg](unsigned int n, std::vector<unsigned int>& list){
+                    typedef boost::graph_traits<FSceneGraph>::out_edge_iterator OutConn;
+                    std::pair<OutConn,OutConn> out = boost::out_edges(n,sg);
+                    for(;out.first!=out.second;++out.first)
+                        list.push_back(boost::target(*out.first,sg));
+                },
+                [&sg](unsigned int n, std::vector<unsigned int>& list){
+                    typedef boost::graph_traits<FSceneGraph>::in_edge_iterator InConn;
+                    std::pair<InConn,InConn> in = boost::in_edges(n,sg);
+                    for(;in.first!=in.second;++in.first)
+                        list.push_back(boost::source(*in.first,sg));
+                });
+        if(!ordered)
+            return status(FAILED,"Can't connect nodes, the connection would make a cycle");
 
+        // is the input field already connected to something else
+        // An input only has one connection so the old one gets replaced. This also
+        // means only one node ever flags an input field during a parallel update.
+        if(tfield->connected) {
+            boost::remove_in_edge_if(n2,[&sg,f2](const FSceneGraph::edge_descriptor& e){ return sg[e].f2==f2; },sg);
+            tfield->connected = false;
+        }
 
-        //}
-             
         // check to see if another field is already connected
-        if(field::can_types_connect<field::START,field::START>::exec(sfield->type,tfield->type)) {
+        if(field::can_types_connect(sfield->type,tfield->type)) {
             FFieldConnection connection = boost::add_edge(n1, n2, sg);
+            invalidate_plan();
+            s.events.topology_changed(n1,event::Connected);
+            s.events.topology_changed(n2,event::Connected);
             sg[connection.first].n1 = n1;
             sg[connection.first].f1 = f1;
             sg[connection.first].n2 = n2;
             sg[connection.first].f2 = f2;
             sg[connection.first].sfield = sfield;
             sg[connection.first].tfield = tfield;
+            sg[connection.first].pull = field::converter(sfield->type,tfield->type);
+            // the input has the source's value right away, the update pulls it again before the node runs
+            if(sg[connection.first].pull)
+                sg[connection.first].pull(sfield,tfield);
             tfield->connected = true;
             tfield->puid = n1;
             tfield->pn = src_node;
             tfield->pf = f1;
+            // the target's input now comes from a different field
+            tfield->update = true;
         } else {
-            std::cout << "could not connect nid " << n1 << " and nid " << n2 << std::endl;
+            if(verbose)
+                std::cout << "could not connect nid " << n1 << " and nid " << n2 << std::endl;
             return status(FAILED,"field types can not be connected");
         }
 
@@ -896,6 +1526,8 @@ namespace scenegraph
      */
     status disconnect(int suid, int sfid, int tuid, int tfid)
     {
+        FSceneGraph& sg = scene().sg;
+        std::unique_lock<std::shared_timed_mutex> write(scene().lock);
         // verify that the disconnect rules are meet
         if(suid == tuid)
             return status(FAILED,"Node 1 can't be the same as Node 2");
@@ -906,21 +1538,102 @@ namespace scenegraph
         typedef typename boost::graph_traits<FSceneGraph>::out_edge_iterator eo;
         std::pair<eo,eo> p = boost::out_edges(suid,sg);
 
+        auto match = [&sg,sfid,tuid,tfid](const FSceneGraph::edge_descriptor& e){
+            return sg[e].f1 == sfid && static_cast<int>(boost::target(e,sg)) == tuid && sg[e].f2 == tfid;
+        };
+
+        bool found=false;
         for(;p.first!=p.second;++p.first){
-            if(sg[*p.first].f1 == sfid && sg[*p.first].f2 == tfid) {
-                // TODO - there might be some cleanup to do here
-                boost::remove_edge(p.first,sg);
-                //std::cout << "found connection to disconnect!\n";
+            if(match(*p.first)) {
+                // the target node needs to update with it's input gone
+                sg[*p.first].tfield->update = true;
+                sg[*p.first].tfield->connected = false;
+                found=true;
             }
         }
 
+        // removing the edges while walking them would invalidate the iterator
+        if(found) {
+            boost::remove_out_edge_if(suid,match,sg);
+            invalidate_plan();
+            scene().events.topology_changed(suid,event::Disconnected);
+            scene().events.topology_changed(tuid,event::Disconnected);
+        }
 
         return status();   
     }
 
-    FTime get_time() { return time; };
+
+    /*!
+     * Add a batch of nodes and connect them.
+     * The uids of the new nodes are added to the end of uids. The connections'
+     * node numbers are indexes into uids, so uids can already hold nodes of
+     * the scene, like the root, for the new nodes to be connected to.
+     * Each node type's plugin is only looked up once and the scene's tables
+     * of nodes are grown once for the whole batch, the graph grows it's own
+     * vertices. If a connection fails the nodes are still added and the
+     * first error is returned.
+     */
+    status add_nodes(const std::vector<FNodeSpec>& nodes, const std::vector<FConnectionSpec>& connections, std::vector<unsigned int>& uids)
+    {
+        Scene& s = scene();
+        std::unique_lock<std::shared_timed_mutex> write(s.lock);
+        FSceneGraph& sg = s.sg;
+
+        const unsigned int reused = std::min<unsigned int>(nodes.size(),s.free_slots.size());
+        const unsigned int count = num_vertices(sg) + nodes.size() - reused;
+        s.order.reserve(count);
+        s.generation.reserve(count);
+        uids.reserve(uids.size()+nodes.size());
+        s.cstate.uid_update.reserve(s.cstate.uid_update.size()+nodes.size());
+
+        // the plugin and type of each node id in the batch
+        std::map<unsigned int,std::pair<int,node::Type> > types;
+
+        status p;
+        for(const FNodeSpec& spec : nodes) {
+            auto t = types.find(spec.node);
+            if(t == types.end()) {
+                node::Type ntype = node::Null;
+                int plugin = plugins.node_plugin(spec.node);
+                plugins.node_type(plugin,spec.node,ntype);
+                t = types.insert(std::make_pair(spec.node,std::make_pair(plugin,ntype))).first;
+            }
+
+            FNodeDescriptor uid = take_node_slot();
+            sg[uid].type = t->second.second;
+            sg[uid].uid = uid;
+            sg[uid].node = spec.node;
+            sg[uid].name = spec.name;
+            sg[uid].layer = 0;
+            sg[uid].row = s.field_store.add_row(spec.node,uid);
+            plugins.create_fields(t->second.first,spec.node,sg[uid].fields,s.field_store);
+            index_node(uid);
+            s.events.topology_changed(uid,event::NodeAdded);
+
+            if(static_cast<int>(uid) > s.cstate.sgState.maxUid)
+                s.cstate.sgState.maxUid = uid;
+            s.cstate.add_uid_to_update(uid);
+            uids.push_back(uid);
+        }
+        invalidate_plan();
+
+        for(const FConnectionSpec& c : connections) {
+            status e;
+            if(c.n1 >= uids.size() || c.n2 >= uids.size())
+                e = status(FAILED,"Can't connect nodes, the connection's node isn't in the batch");
+            else
+                e = make_connection(uids[c.n1],c.f1,uids[c.n2],c.f2,false);
+            if(e.state==FAILED && p.state!=FAILED)
+                p = e;
+        }
+
+        return p;
+    }
+
+    FTime get_time() { return scene().time; };
  
-    void set_time(FTime t) { time=t; };
+    void set_time(FTime t) { scene().time=t; };
  
     //template <int _Type, int _Node>
     //status add_node(int id) { return status(FAILED,"no matching node for add_node"); };
@@ -940,7 +1653,7 @@ namespace scenegraph
     } // namespace scenegraph
 
     #define GET_NODE_DATA(nodedata)\
-    template <> nodedata* DataObject::get_data<nodedata>(FNodeDescriptor node) { return static_cast<nodedata*>(sg[node].data); };
+    template <> nodedata* DataObject::get_data<nodedata>(FNodeDescriptor node) { return static_cast<nodedata*>(scenegraph::scene().sg[node].data); };
 
  
 } // namespace feather
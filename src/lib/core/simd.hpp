@@ -0,0 +1,471 @@
+/***********************************************************************
+ *
+ * Filename: simd.hpp
+ *
+ * Description: Vectorized operations on the number arrays of the array fields.
+ *
+ * Copyright (C) 2015 Richard Layman, rlayman2000@yahoo.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include "deps.hpp"
+#include "types.hpp"
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace feather
+{
+
+    namespace simd
+    {
+
+        /*
+         * A register of numbers and the operations the kernels need on it.
+         * The kernels are written once against Pack and run a register at a
+         * time, the items left at the end of an array go one by one.
+         * This is the fallback, a register of one number. The float and
+         * double packs use AVX when the build has it (-mavx) and SSE2 on any
+         * other x86-64 build, the int pack needs AVX2 or SSE4.1 for it's
+         * multiply and min/max.
+         * load and store take Aligned when the address is on a register
+         * boundary, which it is for the arrays' buffers, see FAlignedAllocator.
+         */
+        typedef std::true_type Aligned;
+        typedef std::false_type Unaligned;
+
+        template <typename _Type>
+        struct Pack
+        {
+            typedef _Type reg;
+            static const unsigned int width = 1;
+            template <typename _Align>
+            static reg load(const _Type* p, _Align) { return *p; };
+            template <typename _Align>
+            static void store(_Type* p, reg r, _Align) { *p = r; };
+            static reg set(_Type v) { return v; };
+            static reg add(reg a, reg b) { return a + b; };
+            static reg sub(reg a, reg b) { return a - b; };
+            static reg mul(reg a, reg b) { return a * b; };
+            static reg min(reg a, reg b) { return (b < a) ? b : a; };
+            static reg max(reg a, reg b) { return (a < b) ? b : a; };
+        };
+
+#if defined(__AVX__)
+        template <>
+        struct Pack<float>
+        {
+            typedef __m256 reg;
+            static const unsigned int width = 8;
+            static reg load(const float* p, Aligned) { return _mm256_load_ps(p); };
+            static reg load(const float* p, Unaligned) { return _mm256_loadu_ps(p); };
+            static void store(float* p, reg r, Aligned) { _mm256_store_ps(p,r); };
+            static void store(float* p, reg r, Unaligned) { _mm256_storeu_ps(p,r); };
+            static reg set(float v) { return _mm256_set1_ps(v); };
+            static reg add(reg a, reg b) { return _mm256_add_ps(a,b); };
+            static reg sub(reg a, reg b) { return _mm256_sub_ps(a,b); };
+            static reg mul(reg a, reg b) { return _mm256_mul_ps(a,b); };
+            static reg min(reg a, reg b) { return _mm256_min_ps(a,b); };
+            static reg max(reg a, reg b) { return _mm256_max_ps(a,b); };
+        };
+
+        template <>
+        struct Pack<double>
+        {
+            typedef __m256d reg;
+            static const unsigned int width = 4;
+            static reg load(const double* p, Aligned) { return _mm256_load_pd(p); };
+            static reg load(const double* p, Unaligned) { return _mm256_loadu_pd(p); };
+            static void store(double* p, reg r, Aligned) { _mm256_store_pd(p,r); };
+            static void store(double* p, reg r, Unaligned) { _mm256_storeu_pd(p,r); };
+            static reg set(double v) { return _mm256_set1_pd(v); };
+            static reg add(reg a, reg b) { return _mm256_add_pd(a,b); };
+            static reg sub(reg a, reg b) { return _mm256_sub_pd(a,b); };
+            static reg mul(reg a, reg b) { return _mm256_mul_pd(a,b); };
+            static reg min(reg a, reg b) { return _mm256_min_pd(a,b); };
+            static reg max(reg a, reg b) { return _mm256_max_pd(a,b); };
+        };
+#elif defined(__SSE2__)
+        template <>
+        struct Pack<float>
+        {
+            typedef __m128 reg;
+            static const unsigned int width = 4;
+            static reg load(const float* p, Aligned) { return _mm_load_ps(p); };
+            static reg load(const float* p, Unaligned) { return _mm_loadu_ps(p); };
+            static void store(float* p, reg r, Aligned) { _mm_store_ps(p,r); };
+            static void store(float* p, reg r, Unaligned) { _mm_storeu_ps(p,r); };
+            static reg set(float v) { return _mm_set1_ps(v); };
+            static reg add(reg a, reg b) { return _mm_add_ps(a,b); };
+            static reg sub(reg a, reg b) { return _mm_sub_ps(a,b); };
+            static reg mul(reg a, reg b) { return _mm_mul_ps(a,b); };
+            static reg min(reg a, reg b) { return _mm_min_ps(a,b); };
+            static reg max(reg a, reg b) { return _mm_max_ps(a,b); };
+        };
+
+        template <>
+        struct Pack<double>
+        {
+            typedef __m128d reg;
+            static const unsigned int width = 2;
+            static reg load(const double* p, Aligned) { return _mm_load_pd(p); };
+            static reg load(const double* p, Unaligned) { return _mm_loadu_pd(p); };
+            static void store(double* p, reg r, Aligned) { _mm_store_pd(p,r); };
+            static void store(double* p, reg r, Unaligned) { _mm_storeu_pd(p,r); };
+            static reg set(double v) { return _mm_set1_pd(v); };
+            static reg add(reg a, reg b) { return _mm_add_pd(a,b); };
+            static reg sub(reg a, reg b) { return _mm_sub_pd(a,b); };
+            static reg mul(reg a, reg b) { return _mm_mul_pd(a,b); };
+            static reg min(reg a, reg b) { return _mm_min_pd(a,b); };
+            static reg max(reg a, reg b) { return _mm_max_pd(a,b); };
+        };
+#endif
+
+#if defined(__AVX2__)
+        template <>
+        struct Pack<int>
+        {
+            typedef __m256i reg;
+            static const unsigned int width = 8;
+            static reg load(const int* p, Aligned) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(p)); };
+            static reg load(const int* p, Unaligned) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); };
+            static void store(int* p, reg r, Aligned) { _mm256_store_si256(reinterpret_cast<__m256i*>(p),r); };
+            static void store(int* p, reg r, Unaligned) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p),r); };
+            static reg set(int v) { return _mm256_set1_epi32(v); };
+            static reg add(reg a, reg b) { return _mm256_add_epi32(a,b); };
+            static reg sub(reg a, reg b) { return _mm256_sub_epi32(a,b); };
+            static reg mul(reg a, reg b) { return _mm256_mullo_epi32(a,b); };
+            static reg min(reg a, reg b) { return _mm256_min_epi32(a,b); };
+            static reg max(reg a, reg b) { return _mm256_max_epi32(a,b); };
+        };
+#elif defined(__SSE4_1__)
+        template <>
+        struct Pack<int>
+        {
+            typedef __m128i reg;
+            static const unsigned int width = 4;
+            static reg load(const int* p, Aligned) { return _mm_load_si128(reinterpret_cast<const __m128i*>(p)); };
+            static reg load(const int* p, Unaligned) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); };
+            static void store(int* p, reg r, Aligned) { _mm_store_si128(reinterpret_cast<__m128i*>(p),r); };
+            static void store(int* p, reg r, Unaligned) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p),r); };
+            static reg set(int v) { return _mm_set1_epi32(v); };
+            static reg add(reg a, reg b) { return _mm_add_epi32(a,b); };
+            static reg sub(reg a, reg b) { return _mm_sub_epi32(a,b); };
+            static reg mul(reg a, reg b) { return _mm_mullo_epi32(a,b); };
+            static reg min(reg a, reg b) { return _mm_min_epi32(a,b); };
+            static reg max(reg a, reg b) { return _mm_max_epi32(a,b); };
+        };
+#endif
+
+
+        // KERNELS
+
+        // true if p is on a register boundary for the pack
+        template <typename _Type>
+        bool aligned(const _Type* p) { return reinterpret_cast<std::uintptr_t>(p) % (Pack<_Type>::width*sizeof(_Type)) == 0; };
+
+        template <typename _Type, typename... _Ptrs>
+        bool aligned(const _Type* p, _Ptrs... rest) { return aligned(p) && aligned(rest...); };
+
+        inline unsigned int gcd(unsigned int a, unsigned int b) { return (b) ? gcd(b,a%b) : a; };
+
+        /*
+         * The loops of the kernels, _Align says if the pointers are all on a
+         * register boundary. The kernels below pick the one to use.
+         */
+        namespace loop
+        {
+
+            template <typename _Align, typename _Type>
+            void add(const _Type* a, const _Type* b, _Type* out, std::size_t n)
+            {
+                typedef Pack<_Type> P;
+                std::size_t i=0;
+                for(; i+P::width <= n; i+=P::width)
+                    P::store(out+i,P::add(P::load(a+i,_Align()),P::load(b+i,_Align())),_Align());
+                for(; i < n; i++)
+                    out[i] = a[i] + b[i];
+            };
+
+            template <typename _Align, typename _Type>
+            void scale(const _Type* a, _Type s, _Type* out, std::size_t n)
+            {
+                typedef Pack<_Type> P;
+                const typename P::reg rs = P::set(s);
+                std::size_t i=0;
+                for(; i+P::width <= n; i+=P::width)
+                    P::store(out+i,P::mul(P::load(a+i,_Align()),rs),_Align());
+                for(; i < n; i++)
+                    out[i] = a[i] * s;
+            };
+
+            template <typename _Align, typename _Type>
+            void lerp(const _Type* a, const _Type* b, _Type t, _Type* out, std::size_t n)
+            {
+                typedef Pack<_Type> P;
+                const typename P::reg rt = P::set(t);
+                std::size_t i=0;
+                for(; i+P::width <= n; i+=P::width) {
+                    const typename P::reg ra = P::load(a+i,_Align());
+                    P::store(out+i,P::add(ra,P::mul(P::sub(P::load(b+i,_Align()),ra),rt)),_Align());
+                }
+                for(; i < n; i++)
+                    out[i] = a[i] + (b[i] - a[i]) * t;
+            };
+
+            template <bool _Max, typename _Align, typename _Type>
+            typename Pack<_Type>::reg reduce_step(typename Pack<_Type>::reg r, const _Type* p)
+            {
+                typedef Pack<_Type> P;
+                return (_Max) ? P::max(r,P::load(p,_Align())) : P::min(r,P::load(p,_Align()));
+            };
+
+            /*
+             * A block of _Regs registers holds whole items, so each lane of
+             * each register always gets the same one of the item's numbers.
+             * For c=3 and a register of 4 that's 3 registers, 4 vertices.
+             * The registers are named instead of in an array so they aren't
+             * kept on the stack. Returns where the blocks ended.
+             */
+            template <bool _Max, typename _Align, unsigned int _Regs, typename _Type>
+            std::size_t reduce_blocks(const _Type* a, std::size_t n, unsigned int c, _Type* out)
+            {
+                static_assert(_Regs >= 1 && _Regs <= 4, "a block is 1 to 4 registers");
+                typedef Pack<_Type> P;
+                const std::size_t w = P::width;
+                const std::size_t block = _Regs*w;
+                if(n < block)
+                    return 0;
+                typename P::reg r0 = P::load(a,_Align());
+                typename P::reg r1 = (_Regs > 1) ? P::load(a+w,_Align()) : r0;
+                typename P::reg r2 = (_Regs > 2) ? P::load(a+2*w,_Align()) : r0;
+                typename P::reg r3 = (_Regs > 3) ? P::load(a+3*w,_Align()) : r0;
+                std::size_t i=block;
+                for(; i+block <= n; i+=block) {
+                    r0 = reduce_step<_Max,_Align>(r0,a+i);
+                    if(_Regs > 1)
+                        r1 = reduce_step<_Max,_Align>(r1,a+i+w);
+                    if(_Regs > 2)
+                        r2 = reduce_step<_Max,_Align>(r2,a+i+2*w);
+                    if(_Regs > 3)
+                        r3 = reduce_step<_Max,_Align>(r3,a+i+3*w);
+                }
+                _Type lanes[4*P::width];
+                P::store(lanes,r0,Unaligned());
+                P::store(lanes+w,r1,Unaligned());
+                P::store(lanes+2*w,r2,Unaligned());
+                P::store(lanes+3*w,r3,Unaligned());
+                for(unsigned int j=0; j < block; j++)
+                    out[j%c] = (_Max) ? std::max(out[j%c],lanes[j]) : std::min(out[j%c],lanes[j]);
+                return i;
+            };
+
+            template <bool _Max, typename _Align, typename _Type>
+            void reduce(const _Type* a, std::size_t n, unsigned int c, _Type* out)
+            {
+                std::size_t i=0;
+                switch(c / gcd(Pack<_Type>::width,c)) {
+                    case 1: i = reduce_blocks<_Max,_Align,1>(a,n,c,out); break;
+                    case 2: i = reduce_blocks<_Max,_Align,2>(a,n,c,out); break;
+                    case 3: i = reduce_blocks<_Max,_Align,3>(a,n,c,out); break;
+                    case 4: i = reduce_blocks<_Max,_Align,4>(a,n,c,out); break;
+                    default: break;
+                }
+                // the blocks end on an item so i%c is the number's place in it's item
+                for(; i < n; i++)
+                    out[i%c] = (_Max) ? std::max(out[i%c],a[i]) : std::min(out[i%c],a[i]);
+            };
+
+        } // namespace loop
+
+        // These work on n numbers, out can be the same as one of the inputs.
+
+        // out = a + b
+        template <typename _Type>
+        void add(const _Type* a, const _Type* b, _Type* out, std::size_t n)
+        {
+            if(aligned(a,b,out))
+                loop::add<Aligned>(a,b,out,n);
+            else
+                loop::add<Unaligned>(a,b,out,n);
+        };
+
+        // out = a * s
+        template <typename _Type>
+        void scale(const _Type* a, _Type s, _Type* out, std::size_t n)
+        {
+            if(aligned(a,out))
+                loop::scale<Aligned>(a,s,out,n);
+            else
+                loop::scale<Unaligned>(a,s,out,n);
+        };
+
+        // out = a + (b - a) * t
+        template <typename _Type>
+        void lerp(const _Type* a, const _Type* b, _Type t, _Type* out, std::size_t n)
+        {
+            static_assert(std::is_floating_point<_Type>::value, "lerp needs a floating point type");
+            if(aligned(a,b,out))
+                loop::lerp<Aligned>(a,b,t,out,n);
+            else
+                loop::lerp<Unaligned>(a,b,t,out,n);
+        };
+
+        /*
+         * The min or max of every c'th number of a, starting at 0 to c-1,
+         * goes in out[0] to out[c-1]. a has items*c numbers, so for c=3 and an
+         * array of vertices out is the corner of the bounding box.
+         * It's done a register at a time for items of up to 4 numbers.
+         */
+        template <bool _Max, typename _Type>
+        void reduce(const _Type* a, std::size_t items, unsigned int c, _Type* out)
+        {
+            const std::size_t n = items*c;
+            if(!n)
+                return;
+            for(unsigned int j=0; j < c; j++)
+                out[j] = a[j];
+            if(aligned(a))
+                loop::reduce<_Max,Aligned>(a,n,c,out);
+            else
+                loop::reduce<_Max,Unaligned>(a,n,c,out);
+        };
+
+        /*
+         * out[i] = src[index[i]] and out[index[i]] = src[i].
+         * These are plain loops, the gather instructions aren't faster than
+         * single loads for indexes that jump around and there is no scatter
+         * instruction before AVX-512.
+         */
+        template <typename _Type>
+        void gather(const _Type* src, const FInt* index, _Type* out, std::size_t n)
+        {
+            for(std::size_t i=0; i < n; i++)
+                out[i] = src[index[i]];
+        };
+
+        template <typename _Type>
+        void scatter(const _Type* src, const FInt* index, _Type* out, std::size_t n)
+        {
+            for(std::size_t i=0; i < n; i++)
+                out[index[i]] = src[i];
+        };
+
+
+        // ARRAYS
+
+        /*
+         * The number type an array item is made of and how many of them
+         * it has, the kernels see an array of items as it's numbers.
+         */
+        template <typename _Type>
+        struct item_traits;
+
+        template <typename _Scalar, unsigned int _Count, typename _Type>
+        struct item_traits_base
+        {
+            static_assert(sizeof(_Type) == _Count*sizeof(_Scalar), "the item has to be just it's numbers");
+            typedef _Scalar scalar;
+            static const unsigned int count = _Count;
+        };
+
+        template <> struct item_traits<FInt> : item_traits_base<FInt,1,FInt> {};
+        template <> struct item_traits<FFloat> : item_traits_base<FFloat,1,FFloat> {};
+        template <> struct item_traits<FDouble> : item_traits_base<FDouble,1,FDouble> {};
+        template <> struct item_traits<FVertex3D> : item_traits_base<FDouble,3,FVertex3D> {};
+        template <> struct item_traits<FVector3D> : item_traits_base<FDouble,4,FVector3D> {};
+        template <> struct item_traits<FNormal3D> : item_traits_base<FDouble,3,FNormal3D> {};
+        template <> struct item_traits<FColorRGB> : item_traits_base<FFloat,4,FColorRGB> {};
+        template <> struct item_traits<FColorRGBA> : item_traits_base<FFloat,4,FColorRGBA> {};
+
+        template <typename _Type>
+        typename item_traits<_Type>::scalar* numbers(FAlignedArray<_Type>& a) { return reinterpret_cast<typename item_traits<_Type>::scalar*>(a.data()); };
+
+        template <typename _Type>
+        const typename item_traits<_Type>::scalar* numbers(const FAlignedArray<_Type>& a) { return reinterpret_cast<const typename item_traits<_Type>::scalar*>(a.data()); };
+
+        /*
+         * The array versions work on whole items, out is resized to the
+         * shorter of the inputs and can be one of them. The scale and lerp
+         * factors are the item's number type.
+         */
+        template <typename _Type>
+        void add(const FAlignedArray<_Type>& a, const FAlignedArray<_Type>& b, FAlignedArray<_Type>& out)
+        {
+            const std::size_t n = std::min(a.size(),b.size());
+            out.resize(n);
+            add(numbers(a),numbers(b),numbers(out),n*item_traits<_Type>::count);
+        };
+
+        template <typename _Type>
+        void scale(const FAlignedArray<_Type>& a, typename item_traits<_Type>::scalar s, FAlignedArray<_Type>& out)
+        {
+            out.resize(a.size());
+            scale(numbers(a),s,numbers(out),a.size()*item_traits<_Type>::count);
+        };
+
+        template <typename _Type>
+        void lerp(const FAlignedArray<_Type>& a, const FAlignedArray<_Type>& b, typename item_traits<_Type>::scalar t, FAlignedArray<_Type>& out)
+        {
+            const std::size_t n = std::min(a.size(),b.size());
+            out.resize(n);
+            lerp(numbers(a),numbers(b),t,numbers(out),n*item_traits<_Type>::count);
+        };
+
+        // the smallest of each of the item's numbers, false if the array is empty
+        template <typename _Type>
+        bool min(const FAlignedArray<_Type>& a, _Type& out)
+        {
+            if(a.empty())
+                return false;
+            reduce<false>(numbers(a),a.size(),item_traits<_Type>::count,reinterpret_cast<typename item_traits<_Type>::scalar*>(&out));
+            return true;
+        };
+
+        // the largest of each of the item's numbers, false if the array is empty
+        template <typename _Type>
+        bool max(const FAlignedArray<_Type>& a, _Type& out)
+        {
+            if(a.empty())
+                return false;
+            reduce<true>(numbers(a),a.size(),item_traits<_Type>::count,reinterpret_cast<typename item_traits<_Type>::scalar*>(&out));
+            return true;
+        };
+
+        // out gets an item for each index, the indexes have to be in src
+        template <typename _Type>
+        void gather(const FAlignedArray<_Type>& src, const FIntArray& index, FAlignedArray<_Type>& out)
+        {
+            out.resize(index.size());
+            gather(src.data(),index.data(),out.data(),index.size());
+        };
+
+        // src's items go to their index in out, out has to be big enough for the indexes
+        template <typename _Type>
+        void scatter(const FAlignedArray<_Type>& src, const FIntArray& index, FAlignedArray<_Type>& out)
+        {
+            scatter(src.data(),index.data(),out.data(),std::min(src.size(),index.size()));
+        };
+
+    } // namespace simd
+
+} // namespace feather
+
+#endif
@@ -0,0 +1,146 @@
+/***********************************************************************
+ *
+ * Filename: snapshot.hpp
+ *
+ * Description: Read only copy of the scenegraph's connections stored in flat arrays.
+ *
+ * Copyright (C) 2015 Richard Layman, rlayman2000@yahoo.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include "deps.hpp"
+#include "types.hpp"
+
+namespace feather
+{
+
+    // one connection as seen from one of it's nodes
+    struct FSnapshotEdge
+    {
+        FSnapshotEdge(unsigned int _uid=0, int _sfid=0, int _tfid=0) : uid(_uid),sfid(_sfid),tfid(_tfid) {};
+        unsigned int uid; // the node at the other end
+        int sfid; // source field
+        int tfid; // target field
+    };
+
+    /*
+     * The GraphSnapshot packs the connections of every node into two arrays,
+     * one for the out edges and one for the in edges, with an offset array
+     * giving where each node's edges start. Walking them is just reading
+     * memory in order instead of following the adjacency list's pointers.
+     * A node's out edges are sorted by their source field and it's in
+     * edges by their target field, so the edges of a single field are
+     * next to each other and can be found with a binary search.
+     * The snapshot is rebuilt from the graph after the topology changes,
+     * the arrays keep their memory so a rebuild doesn't allocate unless
+     * the graph grew. Nothing here allocates while iterating.
+     */
+    class GraphSnapshot
+    {
+        public:
+            // the edges of a node, usable in a range for loop
+            class Range
+            {
+                public:
+                    Range(const FSnapshotEdge* _begin=nullptr, const FSnapshotEdge* _end=nullptr) : m_begin(_begin),m_end(_end) {};
+                    const FSnapshotEdge* begin() const { return m_begin; };
+                    const FSnapshotEdge* end() const { return m_end; };
+                    unsigned int size() const { return m_end - m_begin; };
+                    bool empty() const { return m_begin == m_end; };
+                private:
+                    const FSnapshotEdge* m_begin;
+                    const FSnapshotEdge* m_end;
+            };
+
+            GraphSnapshot() : m_valid(false) {};
+
+            bool valid() const { return m_valid; };
+
+            void invalidate() { m_valid = false; };
+
+            // number of node slots, including the slots of removed nodes
+            unsigned int size() const { return m_out_offsets.empty() ? 0 : m_out_offsets.size()-1; };
+
+            Range out_edges(unsigned int uid) const { return range(m_out,m_out_offsets,uid); };
+
+            Range in_edges(unsigned int uid) const { return range(m_in,m_in_offsets,uid); };
+
+            // the out edges of the node's sfid
+            Range out_edges(unsigned int uid, int sfid) const {
+                Range r = out_edges(uid);
+                auto p = std::equal_range(r.begin(),r.end(),FSnapshotEdge(0,sfid,0),[](const FSnapshotEdge& a, const FSnapshotEdge& b){ return a.sfid < b.sfid; });
+                return Range(p.first,p.second);
+            };
+
+            // the in edges of the node's tfid, an input only has one
+            Range in_edges(unsigned int uid, int tfid) const {
+                Range r = in_edges(uid);
+                auto p = std::equal_range(r.begin(),r.end(),FSnapshotEdge(0,0,tfid),[](const FSnapshotEdge& a, const FSnapshotEdge& b){ return a.tfid < b.tfid; });
+                return Range(p.first,p.second);
+            };
+
+            void build(const FSceneGraph& sg) {
+                const unsigned int count = num_vertices(sg);
+                m_out_offsets.assign(count+1,0);
+                m_in_offsets.assign(count+1,0);
+                m_out.resize(num_edges(sg));
+                m_in.resize(num_edges(sg));
+
+                // count the edges of each node, then turn the counts into offsets
+                for(unsigned int n=0; n < count; n++) {
+                    m_out_offsets[n+1] = m_out_offsets[n] + out_degree(n,sg);
+                    m_in_offsets[n+1] = m_in_offsets[n] + in_degree(n,sg);
+                }
+
+                typedef boost::graph_traits<FSceneGraph>::out_edge_iterator OutConn;
+                typedef boost::graph_traits<FSceneGraph>::in_edge_iterator InConn;
+                for(unsigned int n=0; n < count; n++) {
+                    unsigned int i = m_out_offsets[n];
+                    std::pair<OutConn,OutConn> out = boost::out_edges(n,sg);
+                    for(;out.first!=out.second;++out.first)
+                        m_out[i++] = FSnapshotEdge(boost::target(*out.first,sg),sg[*out.first].f1,sg[*out.first].f2);
+                    std::sort(m_out.begin()+m_out_offsets[n],m_out.begin()+i,[](const FSnapshotEdge& a, const FSnapshotEdge& b){ return a.sfid < b.sfid || (a.sfid == b.sfid && a.uid < b.uid); });
+
+                    i = m_in_offsets[n];
+                    std::pair<InConn,InConn> in = boost::in_edges(n,sg);
+                    for(;in.first!=in.second;++in.first)
+                        m_in[i++] = FSnapshotEdge(boost::source(*in.first,sg),sg[*in.first].f1,sg[*in.first].f2);
+                    std::sort(m_in.begin()+m_in_offsets[n],m_in.begin()+i,[](const FSnapshotEdge& a, const FSnapshotEdge& b){ return a.tfid < b.tfid || (a.tfid == b.tfid && a.uid < b.uid); });
+                }
+
+                m_valid = true;
+            };
+
+        private:
+            Range range(const std::vector<FSnapshotEdge>& edges, const std::vector<unsigned int>& offsets, unsigned int uid) const {
+                if(uid+1 >= offsets.size())
+                    return Range();
+                return Range(edges.data()+offsets[uid],edges.data()+offsets[uid+1]);
+            };
+
+            std::vector<unsigned int> m_out_offsets; // node n's out edges are m_out[m_out_offsets[n]] to m_out[m_out_offsets[n+1]-1]
+            std::vector<unsigned int> m_in_offsets;
+            std::vector<FSnapshotEdge> m_out;
+            std::vector<FSnapshotEdge> m_in;
+            bool m_valid;
+    };
+
+} // namespace feather
+
+#endif
@@ -34,6 +34,30 @@ namespace feather
     {
 
         enum SGMode { None, DoIt, DrawGL, DrawSelection };
+
+        /*
+         * Full calls every node's do_it on each update.
+         * Incremental only calls the do_it of nodes that are dirty or have
+         * an input field that changed since the last update.
+         */
+        enum SGUpdate { Full, Incremental };
+
+        /*
+         * Serial calls the do_its one at a time in the plan's order.
+         * Levels calls all the do_its of a dependency level at the same time
+         * on the worker threads and waits for them to finish before moving
+         * on to the next level.
+         * Tasks calls each do_it on the worker threads as soon as all the
+         * nodes feeding it are done.
+         */
+        enum SGSchedule { Serial, Levels, Tasks };
+
+        /*
+         * Push updates the scenegraph every time a field's value is set.
+         * Pull only flags the field that was set; when a field's value is read
+         * the nodes it depends on are updated and nothing else.
+         */
+        enum SGEvaluate { Push, Pull };
         
         struct FSgState {
             int minUid;
@@ -41,8 +65,12 @@ namespace feather
         };
 
         struct FState {
-            FState() : sgMode(None) { };
+            FState() : sgMode(None), sgUpdate(Full), sgSchedule(Serial), sgEvaluate(Push), transactions(0) { };
             SGMode sgMode;
+            SGUpdate sgUpdate;
+            SGSchedule sgSchedule;
+            SGEvaluate sgEvaluate;
+            unsigned int transactions; // number of open edit transactions, the scenegraph isn't updated while one is open
             FSgState sgState;
             std::vector<int> uid_update;
             void clear_uid_update() { uid_update.clear(); };
@@ -0,0 +1,163 @@
+/***********************************************************************
+ *
+ * Filename: taskscheduler.hpp
+ *
+ * Description: Runs a graph of dependent tasks on the worker threads.
+ *
+ * Copyright (C) 2015 Richard Layman, rlayman2000@yahoo.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef TASKSCHEDULER_HPP
+#define TASKSCHEDULER_HPP
+
+#include "deps.hpp"
+#include "threadpool.hpp"
+
+namespace feather
+{
+
+    /*
+     * The TaskScheduler runs each task as soon as all the tasks feeding it
+     * are done, instead of waiting for a whole level to finish.
+     * Every task has a counter that starts at the number of tasks feeding it
+     * and gets decremented as they finish; the task that brings a counter to
+     * zero pushes the ready task onto it's own queue.
+     * Each thread of the pool works from the back of it's own queue and
+     * steals from the front of the other queues when it runs out of work.
+     * A thread that finds nothing to do sleeps until a task is pushed or
+     * the last task is done, it doesn't spin.
+     * run() returns once every task is done.
+     */
+    class TaskScheduler
+    {
+        public:
+            TaskScheduler(ThreadPool& pool) : m_pool(pool) {};
+
+            /*
+             * indegree[i] is the number of tasks feeding task i and the tasks
+             * fed by task i are succ[offsets[i]] to succ[offsets[i+1]-1].
+             */
+            void run(const std::vector<unsigned int>& indegree,
+                    const std::vector<unsigned int>& offsets,
+                    const std::vector<unsigned int>& succ,
+                    std::function<void(unsigned int)> task)
+            {
+                const unsigned int count = indegree.size();
+                if(!count)
+                    return;
+
+                const unsigned int threads = m_pool.size()+1;
+                std::vector<WorkQueue> queues(threads);
+                std::unique_ptr<std::atomic<unsigned int>[]> pending(new std::atomic<unsigned int>[count]);
+                std::atomic<unsigned int> remaining(count);
+                // tasks in the queues, it's raised before a push and lowered after a pop so it's never short
+                std::atomic<unsigned int> queued(0);
+                std::mutex park_mutex;
+                std::condition_variable parked;
+
+                unsigned int q=0;
+                for(unsigned int i=0; i < count; i++) {
+                    pending[i] = indegree[i];
+                    if(!indegree[i]) {
+                        queues[q].tasks.push_back(i);
+                        queued++;
+                        q = (q+1) % threads;
+                    }
+                }
+
+                // the lock makes sure a thread that's about to sleep sees the change or gets the notify
+                auto wake = [&](unsigned int n){
+                    std::lock_guard<std::mutex> lock(park_mutex);
+                    for(unsigned int i=0; i < n && i < threads; i++)
+                        parked.notify_one();
+                };
+
+                m_pool.run(threads,[&](unsigned int p){
+                        unsigned int t;
+                        while(remaining.load() > 0) {
+                            if(!queues[p].pop(t) && !steal(queues,p,t)) {
+                                std::unique_lock<std::mutex> lock(park_mutex);
+                                parked.wait(lock,[&](){ return !remaining.load() || queued.load(); });
+                                continue;
+                            }
+                            queued--;
+
+                            task(t);
+
+                            unsigned int pushed=0;
+                            for(unsigned int s=offsets[t]; s < offsets[t+1]; s++) {
+                                if(pending[succ[s]].fetch_sub(1) == 1) {
+                                    queued++;
+                                    queues[p].push(succ[s]);
+                                    pushed++;
+                                }
+                            }
+                            // this thread takes one of the tasks it pushed, the others can go to sleeping threads
+                            if(remaining.fetch_sub(1) == 1)
+                                wake(threads);
+                            else if(pushed > 1)
+                                wake(pushed-1);
+                        }
+                        });
+            };
+
+        private:
+            struct WorkQueue
+            {
+                std::mutex mutex;
+                std::deque<unsigned int> tasks;
+
+                void push(unsigned int t) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    tasks.push_back(t);
+                };
+
+                // the owner takes the newest task
+                bool pop(unsigned int& t) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if(tasks.empty())
+                        return false;
+                    t = tasks.back();
+                    tasks.pop_back();
+                    return true;
+                };
+
+                // other threads take the oldest task
+                bool steal(unsigned int& t) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if(tasks.empty())
+                        return false;
+                    t = tasks.front();
+                    tasks.pop_front();
+                    return true;
+                };
+            };
+
+            static bool steal(std::vector<WorkQueue>& queues, unsigned int p, unsigned int& t) {
+                for(unsigned int i=1; i < queues.size(); i++) {
+                    if(queues[(p+i) % queues.size()].steal(t))
+                        return true;
+                }
+                return false;
+            };
+
+            ThreadPool& m_pool;
+    };
+
+} // namespace feather
+
+#endif
@@ -0,0 +1,144 @@
+/***********************************************************************
+ *
+ * Filename: threadpool.hpp
+ *
+ * Description: Worker threads used to update the scenegraph nodes in parallel.
+ *
+ * Copyright (C) 2015 Richard Layman, rlayman2000@yahoo.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include "deps.hpp"
+
+namespace feather
+{
+
+    /*
+     * The ThreadPool keeps it's workers asleep between jobs.
+     * run() hands out the indics of a job to the workers and the calling
+     * thread, and only returns once every index is done, so each call
+     * acts as a barrier.
+     * With no workers the calling thread runs the whole job by itself.
+     */
+    class ThreadPool
+    {
+        public:
+            ThreadPool(unsigned int threads=0) : m_stop(false), m_generation(0) { resize(threads); };
+
+            ~ThreadPool() { stop(); };
+
+            unsigned int size() const { return m_workers.size(); };
+
+            void resize(unsigned int threads) {
+                if(threads == m_workers.size())
+                    return;
+
+                stop();
+                m_stop = false;
+                // the new workers only wait for jobs that start after them
+                for(unsigned int i=0; i < threads; i++)
+                    m_workers.push_back(std::thread(&ThreadPool::work,this,m_generation));
+            };
+
+            // call fn(i) for every i in [0,count)
+            void run(unsigned int count, std::function<void(unsigned int)> fn) {
+                if(!count)
+                    return;
+
+                if(m_workers.empty() || count==1) {
+                    for(unsigned int i=0; i < count; i++)
+                        fn(i);
+                    return;
+                }
+
+                std::shared_ptr<Job> job = std::make_shared<Job>(count,fn);
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_job = job;
+                    m_generation++;
+                }
+                m_wake.notify_all();
+
+                job->work();
+
+                std::unique_lock<std::mutex> lock(job->mutex);
+                job->finished.wait(lock,[&job](){ return job->done.load() == job->count; });
+            };
+
+        private:
+            struct Job
+            {
+                Job(unsigned int _count, std::function<void(unsigned int)>& _fn) : count(_count),fn(_fn),next(0),done(0) {};
+                unsigned int count;
+                std::function<void(unsigned int)> fn;
+                std::atomic<unsigned int> next;
+                std::atomic<unsigned int> done;
+                std::mutex mutex;
+                std::condition_variable finished;
+
+                void work() {
+                    unsigned int i;
+                    while((i = next.fetch_add(1)) < count) {
+                        fn(i);
+                        if(done.fetch_add(1)+1 == count) {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            finished.notify_all();
+                        }
+                    }
+                };
+            };
+
+            void work(unsigned long seen) {
+                while(true) {
+                    std::shared_ptr<Job> job;
+                    {
+                        std::unique_lock<std::mutex> lock(m_mutex);
+                        m_wake.wait(lock,[this,&seen](){ return m_stop || m_generation != seen; });
+                        if(m_stop)
+                            return;
+                        seen = m_generation;
+                        job = m_job;
+                    }
+                    job->work();
+                }
+            };
+
+            void stop() {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_stop = true;
+                }
+                m_wake.notify_all();
+                for(auto& w : m_workers)
+                    w.join();
+                m_workers.clear();
+                m_job.reset();
+            };
+
+            bool m_stop;
+            unsigned long m_generation;
+            std::shared_ptr<Job> m_job;
+            std::vector<std::thread> m_workers;
+            std::mutex m_mutex;
+            std::condition_variable m_wake;
+    };
+
+} // namespace feather
+
+#endif
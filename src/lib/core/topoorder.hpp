@@ -0,0 +1,177 @@
+/***********************************************************************
+ *
+ * Filename: topoorder.hpp
+ *
+ * Description: Keeps the nodes in a topological order as connections are made.
+ *
+ * Copyright (C) 2015 Richard Layman, rlayman2000@yahoo.com
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef TOPOORDER_HPP
+#define TOPOORDER_HPP
+
+#include "deps.hpp"
+
+namespace feather
+{
+
+    /*
+     * The TopoOrder keeps every node after all the nodes that feed it.
+     * When an edge x->y is added and y is already after x nothing happens.
+     * Otherwise only the nodes between y and x in the order get looked at:
+     * the nodes downstream of y that are before x and the nodes upstream
+     * of x that are after y. If x is downstream of y the edge would make a
+     * cycle and it's rejected, else those nodes are moved so the upstream
+     * ones come first, using the same positions they had.
+     * Removing edges never breaks the order so there is nothing to do.
+     * This is Pearce and Kelly's dynamic topological sort.
+     */
+    class TopoOrder
+    {
+        public:
+            TopoOrder() {};
+
+            unsigned int size() const { return m_nodes.size(); };
+
+            // position of the node in the order
+            unsigned int position(unsigned int n) const { return m_position[n]; };
+
+            // the nodes in order
+            const std::vector<unsigned int>& nodes() const { return m_nodes; };
+
+            void clear() {
+                m_position.clear();
+                m_nodes.clear();
+                m_mark.clear();
+            };
+
+            void reserve(unsigned int n) {
+                m_position.reserve(n);
+                m_nodes.reserve(n);
+                m_mark.reserve(n);
+            };
+
+            // the new node is n=size() and goes at the end
+            void add_node() {
+                m_position.push_back(m_nodes.size());
+                m_nodes.push_back(m_nodes.size());
+                m_mark.push_back(0);
+            };
+
+            /*
+             * Update the order for the new edge x->y. Returns false, leaving the order
+             * as it was, if the edge would make a cycle.
+             * succ(n,list) and pred(n,list) add the nodes fed by and feeding n to the list.
+             */
+            template <typename _Succ, typename _Pred>
+            bool add_edge(unsigned int x, unsigned int y, _Succ succ, _Pred pred) {
+                const unsigned int lb = m_position[y];
+                const unsigned int ub = m_position[x];
+                if(lb > ub)
+                    return true;
+                if(x==y)
+                    return false;
+
+                // downstream of y
+                m_forward.clear();
+                m_stack.assign(1,y);
+                m_mark[y] = 1;
+                bool cycle=false;
+                while(!m_stack.empty() && !cycle) {
+                    unsigned int n = m_stack.back();
+                    m_stack.pop_back();
+                    m_forward.push_back(n);
+                    m_list.clear();
+                    succ(n,m_list);
+                    for(unsigned int s : m_list) {
+                        if(s==x) {
+                            cycle=true;
+                            break;
+                        }
+                        if(!m_mark[s] && m_position[s] < ub) {
+                            m_mark[s] = 1;
+                            m_stack.push_back(s);
+                        }
+                    }
+                }
+                if(cycle) {
+                    for(unsigned int n : m_forward)
+                        m_mark[n] = 0;
+                    for(unsigned int n : m_stack)
+                        m_mark[n] = 0;
+                    return false;
+                }
+
+                // upstream of x
+                m_backward.clear();
+                m_stack.assign(1,x);
+                m_mark[x] = 1;
+                while(!m_stack.empty()) {
+                    unsigned int n = m_stack.back();
+                    m_stack.pop_back();
+                    m_backward.push_back(n);
+                    m_list.clear();
+                    pred(n,m_list);
+                    for(unsigned int p : m_list) {
+                        if(!m_mark[p] && m_position[p] > lb) {
+                            m_mark[p] = 1;
+                            m_stack.push_back(p);
+                        }
+                    }
+                }
+
+                // the upstream nodes take the first of the freed positions
+                auto by_position = [this](unsigned int a, unsigned int b){ return m_position[a] < m_position[b]; };
+                std::sort(m_forward.begin(),m_forward.end(),by_position);
+                std::sort(m_backward.begin(),m_backward.end(),by_position);
+
+                m_slots.clear();
+                for(unsigned int n : m_backward)
+                    m_slots.push_back(m_position[n]);
+                for(unsigned int n : m_forward)
+                    m_slots.push_back(m_position[n]);
+                std::sort(m_slots.begin(),m_slots.end());
+
+                unsigned int i=0;
+                for(unsigned int n : m_backward) {
+                    m_mark[n] = 0;
+                    m_position[n] = m_slots[i];
+                    m_nodes[m_slots[i++]] = n;
+                }
+                for(unsigned int n : m_forward) {
+                    m_mark[n] = 0;
+                    m_position[n] = m_slots[i];
+                    m_nodes[m_slots[i++]] = n;
+                }
+                return true;
+            };
+
+        private:
+            std::vector<unsigned int> m_position; // position of each node
+            std::vector<unsigned int> m_nodes; // node at each position
+            std::vector<char> m_mark;
+            // kept between calls so connecting doesn't allocate
+            std::vector<unsigned int> m_forward;
+            std::vector<unsigned int> m_backward;
+            std::vector<unsigned int> m_stack;
+            std::vector<unsigned int> m_list;
+            std::vector<unsigned int> m_slots;
+    };
+
+} // namespace feather
+
+#endif
@@ -104,17 +104,71 @@ namespace feather
     typedef double FMatrix[4][4];
 
     // Arrays
-    typedef std::vector<FBool> FBoolArray;
-    typedef std::vector<FInt> FIntArray;
-    typedef std::vector<FUInt> FUIntArray;
-    typedef std::vector<FDouble> FDoubleArray;
+
+    // byte boundary the buffers of the number arrays start on, the width of an AVX register
+    static const std::size_t FARRAY_ALIGN = 32;
+
+    /*
+     * Allocator for the arrays of numbers and number structs. The buffer
+     * starts on a FARRAY_ALIGN boundary so the kernels in simd.hpp never
+     * have a load split across cache lines at the start of an array.
+     * The pointer operator new gave is kept just before the buffer.
+     */
+    template <typename _Type>
+    struct FAlignedAllocator
+    {
+        typedef _Type value_type;
+
+        FAlignedAllocator() {};
+        template <typename _Other>
+        FAlignedAllocator(const FAlignedAllocator<_Other>&) {};
+
+        _Type* allocate(std::size_t n) {
+            void* raw = ::operator new(n*sizeof(_Type) + FARRAY_ALIGN);
+            std::uintptr_t p = (reinterpret_cast<std::uintptr_t>(raw) + FARRAY_ALIGN) & ~(FARRAY_ALIGN - 1);
+            reinterpret_cast<void**>(p)[-1] = raw;
+            return reinterpret_cast<_Type*>(p);
+        };
+
+        void deallocate(_Type* p, std::size_t) {
+            if(p)
+                ::operator delete(reinterpret_cast<void**>(p)[-1]);
+        };
+    };
+
+    template <typename _Type, typename _Other>
+    bool operator==(const FAlignedAllocator<_Type>&, const FAlignedAllocator<_Other>&) { return true; };
+
+    template <typename _Type, typename _Other>
+    bool operator!=(const FAlignedAllocator<_Type>&, const FAlignedAllocator<_Other>&) { return false; };
+
+    template <typename _Type>
+    using FAlignedArray = std::vector<_Type,FAlignedAllocator<_Type>>;
+
+    /*
+     * An item of a bool array. std::vector<bool> packs it's bits, so it has
+     * no buffer to point to and gives a proxy instead of a reference, each
+     * bool here gets a byte.
+     */
+    struct FBoolItem
+    {
+        FBoolItem(FBool _v=false) : v(_v) {};
+        operator FBool() const { return v; };
+        FBool v;
+    };
+
+    typedef FAlignedArray<FBoolItem> FBoolArray;
+    typedef FAlignedArray<FInt> FIntArray;
+    typedef FAlignedArray<FUInt> FUIntArray;
+    typedef FAlignedArray<FFloat> FFloatArray;
+    typedef FAlignedArray<FDouble> FDoubleArray;
     typedef std::vector<FString> FStringArray;
-    typedef std::vector<FVertex3D> FVertex3DArray;
-    typedef std::vector<FVertex3D> FVertex3DArray;
-    typedef std::vector<FColorRGB> FColorRGBArray;
-    typedef std::vector<FColorRGBA> FColorRGBAArray;
-    typedef std::vector<FTextureCoord> FTextureCoordArray;
-    typedef std::vector<FNormal3D> FNormal3DArray;
+    typedef FAlignedArray<FVertex3D> FVertex3DArray;
+    typedef FAlignedArray<FVector3D> FVectorArray;
+    typedef FAlignedArray<FColorRGB> FColorRGBArray;
+    typedef FAlignedArray<FColorRGBA> FColorRGBAArray;
+    typedef FAlignedArray<FTextureCoord> FTextureCoordArray;
+    typedef FAlignedArray<FNormal3D> FNormal3DArray;
     typedef std::vector<FFace> FFaceArray;
 
     struct FStatus
@@ -151,6 +205,83 @@ namespace feather
     };
 
 
+    /*
+     * An array that shares it's buffer with the copies made of it. The
+     * buffer is only copied when a copy that shares it gets changed, so
+     * copying a mesh from one field to another, or out of a field to draw
+     * it, only bumps a reference count.
+     * Reading is done through the const functions and cbegin()/cend(),
+     * which never copy. The non const begin(), end() and [] change the
+     * items in place, like write() they copy the buffer first if it's
+     * shared, so read a non const array through read() or the c functions.
+     * Each array has one owner that writes it. Copies can be used by
+     * different threads, a single array can't. The buffer's use count is
+     * only a hint when copies are on other threads: one being dropped at the
+     * same time can make write() copy when it didn't have to, but it never
+     * writes a buffer another array still holds.
+     * The buffer is an FAlignedArray unless another _Array is given.
+     */
+    template <typename _Type, typename _Array=FAlignedArray<_Type> >
+    class FSharedArray
+    {
+        public:
+            typedef _Array Array;
+            typedef _Type value_type;
+            typedef typename Array::size_type size_type;
+            typedef typename Array::const_iterator const_iterator;
+            typedef typename Array::iterator iterator;
+
+            FSharedArray() {};
+            FSharedArray(const Array& a) : m_data(std::make_shared<Array>(a)) {};
+            FSharedArray(Array&& a) : m_data(std::make_shared<Array>(std::move(a))) {};
+            FSharedArray& operator=(const Array& a) { m_data = std::make_shared<Array>(a); return *this; };
+            FSharedArray& operator=(Array&& a) { m_data = std::make_shared<Array>(std::move(a)); return *this; };
+
+            const Array& read() const { return (m_data) ? *m_data : empty_array(); };
+            operator const Array&() const { return read(); };
+
+            size_type size() const { return (m_data) ? m_data->size() : 0; };
+            bool empty() const { return size()==0; };
+            const _Type& at(size_type i) const { return read().at(i); };
+            const _Type& operator[](size_type i) const { assert(i < size()); return read()[i]; };
+            const_iterator begin() const { return read().begin(); };
+            const_iterator end() const { return read().end(); };
+            const_iterator cbegin() const { return read().begin(); };
+            const_iterator cend() const { return read().end(); };
+            const _Type* data() const { return read().data(); };
+
+            // these change the items so they go through write()
+            _Type& operator[](size_type i) { assert(i < size()); return write()[i]; };
+            iterator begin() { return write().begin(); };
+            iterator end() { return write().end(); };
+
+            // true if another array has the same buffer, only a hint if that array is on another thread
+            bool shared() const { return m_data && m_data.use_count() > 1; };
+
+            // the array's own buffer to change
+            Array& write() {
+                if(!m_data)
+                    m_data = std::make_shared<Array>();
+                else if(m_data.use_count() > 1)
+                    m_data = std::make_shared<Array>(*m_data);
+                return *m_data;
+            };
+
+            void push_back(const _Type& item) { write().push_back(item); };
+            template <typename _Iter>
+            void assign(_Iter first, _Iter last) { m_data = std::make_shared<Array>(first,last); };
+            void resize(size_type n) { write().resize(n); };
+            void reserve(size_type n) { write().reserve(n); };
+            // the other copies keep the buffer
+            void clear() { m_data.reset(); };
+
+        private:
+            static const Array& empty_array() { static const Array a; return a; };
+
+            std::shared_ptr<Array> m_data;
+    };
+
+
     // Mesh Components
 
     typedef struct {
@@ -164,20 +295,25 @@ namespace feather
         std::vector<FSmoothingGroup> sg;
     } FFaceGroup;
 
+    /*
+     * The mesh's arrays are shared between the copies of the mesh, see
+     * FSharedArray. A node that changes a mesh it got from it's input only
+     * copies the arrays it changes.
+     */
     struct FMesh
     {
         enum Type { TRI, QUAD, VARY } type;
-        FVertex3DArray v;
-        FTextureCoordArray st;
-        FVertex3DArray vn;
-        FFaceArray f;
+        FSharedArray<FVertex3D> v;
+        FSharedArray<FTextureCoord> st;
+        FSharedArray<FVertex3D> vn;
+        FSharedArray<FFace,FFaceArray> f;
 
         inline void add_face(const FFace face) { f.push_back(face); };
 
-        inline void assign_v(const FVertex3DArray& _v) { v.assign(_v.begin(),_v.end()); };
-        inline void assign_st(const FTextureCoordArray& _st) { st.assign(_st.begin(),_st.end()); };
-        inline void assign_vn(const FVertex3DArray& _vn) { vn.assign(_vn.begin(),_vn.end()); };
-        inline void assign_f(const FFaceArray& _f) { f.assign(_f.begin(),_f.end()); };
+        inline void assign_v(const FVertex3DArray& _v) { v = _v; };
+        inline void assign_st(const FTextureCoordArray& _st) { st = _st; };
+        inline void assign_vn(const FVertex3DArray& _vn) { vn = _vn; };
+        inline void assign_f(const FFaceArray& _f) { f = _f; };
 
         // remove all the vertex, normals, tex coords and faces from the mesh
         inline void clear() { v.clear(); st.clear(); vn.clear(); };
@@ -208,16 +344,9 @@ namespace feather
             } );
             
             // replace the old face and add the new one right after it.
-            std::vector<FFace> sface;
-            sface.push_back(f1);
-            sface.push_back(f2);
-            auto it = f.begin();
-            // set the iterator to the point where the faces need to be inserted
-            it=it+face; // set the iterator to the face that needs to be replaced
-            // remove the old face
-            f.erase(it);
-            // add the two new faces in it's place
-            f.insert(it,sface.begin(),sface.end());
+            FFaceArray& faces = f.write();
+            faces.at(face) = f1;
+            faces.insert(faces.begin()+face+1,f2);
 
             return true;
         };
@@ -233,7 +362,8 @@ namespace feather
 
     typedef struct {} FAttributeArray;
 
-    typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::directedS, FNode, FConnection> FSceneGraph;
+    // bidirectional so the connections feeding a node can be found without looking at every node
+    typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::bidirectionalS, FNode, FConnection> FSceneGraph;
 
     typedef FSceneGraph::vertex_descriptor FNodeDescriptor;
 
@@ -241,6 +371,8 @@ namespace feather
 
     struct PluginNodeFields;
 
+    namespace cache { class NodeCache; }
+
 };
 
 #include "draw.hpp"
@@ -250,7 +382,7 @@ namespace feather
 
     struct FNode
     {
-        FNode(node::Type t=node::Empty) : type(t)/*, parent(NULL),*/ {};
+        FNode(node::Type t=node::Empty) : uid(0),node(0),type(t),layer(0),dirty(true),removed(false),row(0),version(0)/*, parent(NULL),*/ {};
         int uid; // unique id number
         int node; // node type enum
         field::Fields fields; // this holds the field data
@@ -258,6 +390,11 @@ namespace feather
         std::string name;
         node::Type type; // this is the node group type
         int layer; // what layer is the node stored in
+        bool dirty; // the node's do_it needs to be called on the next incremental update
+        std::shared_ptr<cache::NodeCache> cache; // output values for inputs that were already seen, null if the node isn't cached
+        bool removed; // the node was removed and it's slot is waiting to be reused
+        unsigned int row; // row of the node's fields in the scene's field store
+        uint64_t version; // scene version of the node's last do_it, it's outputs have the same version
         //DataObject* parent; // ??still used??
         //FAttributeArray* attrs; // ??still used??
     };
@@ -266,7 +403,7 @@ namespace feather
 
     struct FConnection
     {
-        FConnection() {};
+        FConnection() : pull(nullptr) {};
         field::Type t1; // source type
         FNodeDescriptor n1; // source node 
         int f1; // source field
@@ -275,12 +412,106 @@ namespace feather
         int f2; // target field
         field::FieldBase* sfield; // source field
         field::FieldBase* tfield; // target field
+        field::Converter pull; // copies or converts the source value into the target, null for fields without a value, see field::converter()
         //field::Connection::Type conn_type;
         //FField* pfield; // parent field
         //FNode* pnode; // parent node
         //int field;
     };
 
+    // Evaluation Plan
+    // The nodes in the order their do_it gets called during an update.
+    // The steps are grouped by level; nodes in the same level don't feed each other.
+
+    struct FEvalStep
+    {
+        FEvalStep(unsigned int _uid=0, int _nid=0, field::Fields* _fields=nullptr) : uid(_uid),nid(_nid),fields(_fields),level(0) {};
+        unsigned int uid;
+        int nid;
+        field::Fields* fields;
+        unsigned int level; // longest path from the root to the node
+    };
+
+    // a connected input of a step, the fields are found by their slot in the node's Fields
+    struct FEvalInput
+    {
+        field::Converter pull; // see FConnection
+        field::FieldBase* src; // the scene's source field
+        int step; // step of the source node, -1 if it's not in the plan
+        unsigned int src_slot;
+        unsigned int dst_slot;
+    };
+
+    struct FEvalPlan
+    {
+        FEvalPlan() : valid(false) {};
+        std::vector<FEvalStep> steps;
+        std::vector<unsigned int> levels; // index of the first step of each level, plus the step count at the end
+        // the steps fed by steps[i] are succ[succ_offsets[i]] to succ[succ_offsets[i+1]-1]
+        std::vector<unsigned int> succ_offsets;
+        std::vector<unsigned int> succ;
+        std::vector<unsigned int> indegree; // number of steps feeding each step
+        std::vector<int> position; // step of each uid, -1 if the node is not in the plan
+        // the connected inputs of steps[i] are inputs[input_offsets[i]] to inputs[input_offsets[i+1]-1]
+        std::vector<unsigned int> input_offsets;
+        std::vector<FEvalInput> inputs;
+        bool valid; // false when the graph's topology changed since the plan was built
+
+        /*
+         * Copy or convert the values of step i's connected inputs into the
+         * node's own input fields, which is all a node's do_it reads.
+         * Everything that runs a step calls this first. source(in) returns
+         * the field the input reads from and target is the step's Fields,
+         * so a view can run the plan on copies of the scene's fields.
+         */
+        template <typename _Source>
+        void pull_inputs(unsigned int i, _Source source, field::Fields& target) const {
+            for(unsigned int n=input_offsets[i]; n < input_offsets[i+1]; n++) {
+                const FEvalInput& in = inputs[n];
+                in.pull(source(in),target[in.dst_slot]);
+            }
+        };
+    };
+
+    /*
+     * A node's uid is the slot it's stored in and slots get reused after a node
+     * is removed. The handle also keeps the slot's generation, which changes
+     * every time the slot is emptied, so a handle to a removed node can be
+     * told apart from the node that took it's slot.
+     */
+    struct FNodeHandle
+    {
+        FNodeHandle(unsigned int _uid=0, unsigned int _generation=0) : uid(_uid),generation(_generation) {};
+        unsigned int uid;
+        unsigned int generation;
+    };
+
+    // a node's field
+    struct FFieldId
+    {
+        FFieldId(unsigned int _uid=0, int _fid=0) : uid(_uid),fid(_fid) {};
+        unsigned int uid;
+        int fid;
+    };
+
+    // a node to add with add_nodes()
+    struct FNodeSpec
+    {
+        FNodeSpec(unsigned int _node=0, std::string _name="") : node(_node),name(_name) {};
+        unsigned int node; // node id from the plugin
+        std::string name;
+    };
+
+    // a connection made by add_nodes(), n1 and n2 are indexes into the uid list
+    struct FConnectionSpec
+    {
+        FConnectionSpec(unsigned int _n1=0, int _f1=0, unsigned int _n2=0, int _f2=0) : n1(_n1),f1(_f1),n2(_n2),f2(_f2) {};
+        unsigned int n1; // source node
+        int f1; // source field
+        unsigned int n2; // target node
+        int f2; // target field
+    };
+
 } // namespace feather
 
 #endif
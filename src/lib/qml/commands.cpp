@@ -28,9 +28,8 @@
 
 using namespace feather;
 
-static PluginManager plugins;
-
 status qml::command::init() {
+    state::FState& cstate = scenegraph::scene().cstate;
     load_plugins();
     cstate.sgState.minUid=0;
     cstate.sgState.maxUid=0;
@@ -45,8 +44,11 @@ status qml::command::init() {
     //int uid1 = add_node(320,"CubeShape"); // PolyShape
     //scenegraph::connect(0,4,uid1,1); // connect PolyCube.out to PolyShape.in
 
-    smg::Instance()->add_state(selection::Node,0,0,0);
+    scenegraph::add_selection(selection::Node,0,0,0);
  
+    // only update the nodes effected by field changes
+    scenegraph::set_update_mode(state::Incremental);
+
     // just testing the do_it plugin calls
     cstate.sgMode = state::DoIt;
     scenegraph::update();
@@ -55,11 +57,58 @@ status qml::command::init() {
     return status();
 }
 
+void qml::command::begin_transaction()
+{
+    scenegraph::scene().cstate.transactions++;
+}
+
+status qml::command::commit()
+{
+    state::FState& cstate = scenegraph::scene().cstate;
+    if(!cstate.transactions)
+        return status(FAILED,"no transaction to commit");
+
+    cstate.transactions--;
+    if(cstate.transactions || cstate.sgEvaluate==state::Pull)
+        return status();
+
+    // nothing in the transaction dirtied the scene
+    if(!scenegraph::needs_update())
+        return status();
+
+    // only the nodes effected by the edits need to be updated
+    state::SGUpdate mode = cstate.sgUpdate;
+    cstate.sgUpdate = state::Incremental;
+    status p = scenegraph::update();
+    cstate.sgUpdate = mode;
+    return p;
+}
+
+bool qml::command::in_transaction()
+{
+    return scenegraph::scene().cstate.transactions > 0;
+}
+
+unsigned int qml::command::subscribe_events(const event::Filter& filter, event::Handler handler)
+{
+    return scenegraph::events().subscribe(filter,handler);
+}
+
+void qml::command::unsubscribe_events(unsigned int id)
+{
+    scenegraph::events().unsubscribe(id);
+}
+
+void qml::command::flush_events()
+{
+    scenegraph::events().flush();
+}
+
 unsigned int qml::command::add_node(const unsigned int nid, const std::string name)
 {
     status e;
+    // the scenegraph keeps the state's maxUid, a reused uid can be lower than it
     unsigned int uid =  scenegraph::add_node(nid,name,e);
-    cstate.sgState.maxUid = uid;
     return uid;
     /*
     switch(type)
@@ -85,8 +134,14 @@ unsigned int qml::command::add_node(const unsigned int nid, const std::string na
     //return status();
 }
 
+status qml::command::add_nodes(const std::vector<FNodeSpec>& nodes, const std::vector<FConnectionSpec>& connections, std::vector<unsigned int>& uids)
+{
+    return scenegraph::add_nodes(nodes,connections,uids);
+}
+
 bool qml::command::nodes_added(std::vector<unsigned int>& uids)
 {
+    state::FState& cstate = scenegraph::scene().cstate;
     uids.assign(cstate.uid_update.begin(),cstate.uid_update.end());
     //cstate.clear_uid_update();
 
@@ -110,10 +165,8 @@ void qml::command::nodes_updated()
 
 bool qml::command::node_exists(int uid)
 {
-    // TODO - this is a temp fix for the minute
-    // This will need to be fixed in the future since nodes will be taken away
-    // so the indics could jump
-    return ( scenegraph::get_max_uid() >= uid) ? true : false;
+    // removed nodes leave their uid empty until a new node reuses it
+    return scenegraph::node_exist(uid);
 }
 
 status qml::command::connect_nodes(int n1, int f1, int n2, int f2)
@@ -156,11 +209,36 @@ status qml::command::get_node_connected_uids(int uid, int fid, std::vector<int>&
     return scenegraph::get_node_connected_uids(uid,fid,uids);
 }
 
+status qml::command::get_node_input_uids(int uid, std::vector<int>& uids)
+{
+    return scenegraph::get_node_input_uids(uid,uids);
+}
+
+const GraphSnapshot& qml::command::get_graph_snapshot()
+{
+    return scenegraph::snapshot();
+}
+
 status qml::command::get_node_draw_items(int nid, draw::DrawItems& items)
 {
     return scenegraph::get_node_draw_items(nid,items);
 }
 
+status qml::command::set_node_cache(int uid, unsigned int size)
+{
+    return scenegraph::set_node_cache(uid,size);
+}
+
+status qml::command::get_node_cache_stats(int uid, unsigned int& hits, unsigned int& misses)
+{
+    return scenegraph::get_node_cache_stats(uid,hits,misses);
+}
+
+status qml::command::evaluate_frames(int tuid, int tfid, FReal start, FReal end, FReal step, const std::vector<FFieldId>& outputs, std::vector<FFrame>& frames)
+{
+    return scenegraph::evaluate_frames(tuid,tfid,start,end,step,outputs,frames);
+}
+
 status qml::command::load_plugins()
 {
     return scenegraph::load_plugins(); 
@@ -173,7 +251,11 @@ status qml::command::run_command(std::string cmd, feather::parameter::ParameterL
 
 status qml::command::run_command_string(std::string str)
 {
-    return plugins.run_command_string(str);
+    // the command's edits get updated once it's done
+    begin_transaction();
+    status p = plugins.run_command_string(str);
+    status c = commit();
+    return (c.state==FAILED) ? c : p;
 }
 
 
@@ -241,7 +323,7 @@ void qml::command::add_node_to_layer(int uid, int lid)
 // If the node is connected, the parent field base is returned.
 status qml::command::get_field_base(int uid, int fid, feather::field::FieldBase* &f)
 {
-    f = scenegraph::get_fieldBase(uid,sg[uid].node,fid);
+    f = scenegraph::get_fieldBase(uid,fid);
     if(!f) {
         return status(FAILED,"null field base\n");
     }
@@ -253,7 +335,7 @@ status qml::command::get_node_field_base(int uid, int fid, feather::field::Field
 {
     //typedef field::Field<int>* fielddata;
     //fielddata f = static_cast<fielddata>(scenegraph::get_fieldBase(uid,node,field));
-    f = scenegraph::get_node_fieldBase(uid,sg[uid].node,fid);
+    f = scenegraph::get_node_fieldBase(uid,fid);
     if(!f) {
         return status(FAILED,"null field base\n");
     }
@@ -281,36 +363,53 @@ status qml::command::get_field_val(int uid, int node, int field, bool& val)
 // int
 status qml::command::get_field_val(int uid, int node, int field, int& val)
 {
-    typedef field::Field<int>* fielddata;
-    fielddata f = static_cast<fielddata>(scenegraph::get_fieldBase(uid,node,field));
-    if(!f)
+    // in Pull mode the nodes the field depends on get updated when it's read
+    if(scenegraph::get_evaluate_mode()==state::Pull)
+        scenegraph::evaluate(uid);
+    field::FieldView<int> view = scenegraph::get_field_view<int>(uid,field);
+    if(!view) {
         std::cout << uid << "," << node << "," << field << " NULL INT FIELD\n";
-    else  
-        val=f->value;
+        return status(FAILED,"no int field found");
+    }
+    val=*view;
     return status();
 }
 
 // real 
 status qml::command::get_field_val(int uid, int node, int field, FReal& val)
 {
-    typedef field::Field<FReal>* fielddata;
-    fielddata f = static_cast<fielddata>(scenegraph::get_fieldBase(uid,node,field));
-    if(!f)
+    // in Pull mode the nodes the field depends on get updated when it's read
+    if(scenegraph::get_evaluate_mode()==state::Pull)
+        scenegraph::evaluate(uid);
+    field::FieldView<FReal> view = scenegraph::get_field_view<FReal>(uid,field);
+    if(!view) {
         std::cout << uid << "," << node << "," << field << " NULL REAL FIELD\n";
-    else  
-        val=f->value;
+        return status(FAILED,"no real field found");
+    }
+    val=*view;
     return status();
 }
 
 // FMesh
+// this copies the whole mesh, use get_field_view() to read it in place
 status qml::command::get_field_val(int uid, int node, int field, FMesh& val)
 {
-    typedef field::Field<FMesh>* fielddata;
-    fielddata f = static_cast<fielddata>(scenegraph::get_fieldBase(uid,node,field));
-    if(!f)
-        std::cout << uid << "," << node << "," << field << " NULL FIELD\n";
-    else  
-        val=f->value;
+    field::FieldView<FMesh> view;
+    status p = get_field_view(uid,node,field,view);
+    if(p.state==FAILED)
+        return p;
+    val=*view;
+    return status();
+}
+
+status qml::command::get_field_view(int uid, int node, int field, field::FieldView<FMesh>& view)
+{
+    // in Pull mode the nodes the field depends on get updated when it's read
+    if(scenegraph::get_evaluate_mode()==state::Pull)
+        scenegraph::evaluate(uid);
+    view = scenegraph::get_field_view<FMesh>(uid,field);
+    if(!view)
+        return status(FAILED,"no mesh field found");
     return status();
 }
 
@@ -326,35 +425,36 @@ status qml::command::set_field_val(int uid, int node, int field, bool& val)
 // int
 status qml::command::set_field_val(int uid, int node, int field, int& val)
 {
-    typedef field::Field<int>* fielddata;
-    fielddata f = static_cast<fielddata>(scenegraph::get_fieldBase(uid,node,field));
-    if(!f)
+    status p = scenegraph::set_field_value<int>(uid,field,val);
+    if(p.state==FAILED)
         std::cout << "NULL INT FIELD\n";
-    else { 
-        f->value=val;
-        f->update=true;
+    else if(scenegraph::get_evaluate_mode()==state::Push && !in_transaction())
         scenegraph::update();
-    } 
     return status();
 }
 
 // real 
 status qml::command::set_field_val(int uid, int node, int field, FReal& val)
 {
-    typedef field::Field<FReal>* fielddata;
-    fielddata f = static_cast<fielddata>(scenegraph::get_fieldBase(uid,node,field));
-    if(!f)
+    status p = scenegraph::set_field_value<FReal>(uid,field,val);
+    if(p.state==FAILED)
         std::cout << "NULL REAL FIELD\n";
-    else {
-        std::cout << "setting real value for uid:" << uid << " nid:" << node << " fid:" << field << " value:" << val << std::endl; 
-        f->value=val;
-        f->update=true;
+    else if(scenegraph::get_evaluate_mode()==state::Push && !in_transaction())
         scenegraph::update();
-    }
     return status();
 }
 
 
+uint64_t qml::command::get_field_version(int uid, int fid)
+{
+    return scenegraph::get_field_version(uid,fid);
+}
+
+uint64_t qml::command::get_node_version(int uid)
+{
+    return scenegraph::get_node_version(uid);
+}
+
 status qml::command::get_field_connection_status(int uid, int field, bool& val)
 {
     field::FieldBase* f = scenegraph::get_node_fieldBase(uid,field);
@@ -371,28 +471,14 @@ status qml::command::get_field_connection_status(int uid, int node, int field, b
 
 status qml::command::get_field_connection_status(int suid, int sfid, int tuid, int tfid, bool& val)
 {
-    field::FieldBase* f = scenegraph::get_node_fieldBase(tuid,tfid);
-
-    if(f->connected && f->puid == suid && f->pf == sfid)
-        val = true;
-    else
-        val = false;
-
+    val = scenegraph::fields_connected(suid,sfid,tuid,tfid);
     return status();
 }
 
 status qml::command::get_connected_fid(int uid, int fid, int& suid, int& sfid)
 {
-    // if nothing is connected, set the source to 0
-    field::FieldBase* f = scenegraph::get_fieldBase(uid,fid);
-    if(!f->connected){
-        suid=0;
-        sfid=0;
-        return status(FAILED,"nothing connected to node's fid");
-    }
-    suid = f->puid;
-    sfid = f->pf;
-    return status();
+    // if nothing is connected, the source is set to 0
+    return scenegraph::get_connected_fid(uid,fid,suid,sfid);
 }
 
 status qml::command::get_fid_list(int uid, int nid, field::connection::Type conn, std::vector<field::FieldBase*>& list)
@@ -446,19 +532,47 @@ void qml::command::get_node_name(const unsigned int uid, std::string& name, stat
     scenegraph::get_node_name(uid,name,error);
 }
 
+status qml::command::set_node_name(const unsigned int uid, const std::string name)
+{
+    return scenegraph::set_node_name(uid,name);
+}
+
 void qml::command::scenegraph_update()
 {
+    // the commit will do the update
+    if(in_transaction())
+        return;
     scenegraph::update();
 }
 
+void qml::command::set_thread_count(unsigned int threads)
+{
+    scenegraph::set_thread_count(threads);
+}
+
+unsigned int qml::command::get_thread_count()
+{
+    return scenegraph::get_thread_count();
+}
+
+void qml::command::set_evaluate_mode(state::SGEvaluate mode)
+{
+    scenegraph::set_evaluate_mode(mode);
+}
+
+void qml::command::set_update_schedule(state::SGSchedule schedule)
+{
+    scenegraph::set_schedule(schedule);
+}
+
 int qml::command::get_min_uid()
 {
-    return cstate.sgState.minUid; 
+    return scenegraph::scene().cstate.sgState.minUid; 
 }
 
 int qml::command::get_max_uid()
 {
-    return cstate.sgState.maxUid; 
+    return scenegraph::scene().cstate.sgState.maxUid; 
 }
 
 void qml::command::get_plugins(std::vector<PluginInfo>& list)
@@ -498,6 +612,11 @@ status qml::command::get_selected_nodes(std::vector<int>& uids)
     return scenegraph::get_selected_nodes(uids);
 }
 
+bool qml::command::node_selected(int uid)
+{
+    return scenegraph::node_selected(uid);
+}
+
 void qml::command::clear_selection()
 {
     scenegraph::clear_selection();
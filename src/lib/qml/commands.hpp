@@ -32,6 +32,11 @@
 #include "pluginmanager.hpp"
 #include "field.hpp"
 #include "draw.hpp"
+#include "state.hpp"
+#include "frames.hpp"
+#include "snapshot.hpp"
+#include "fieldview.hpp"
+#include "events.hpp"
 
 namespace feather
 {
@@ -44,9 +49,24 @@ namespace feather
 
             status init();
 
+            /*
+             * Transactions
+             * While a transaction is open, setting field values, adding nodes and
+             * connecting them doesn't update the scenegraph. commit() closes the
+             * transaction and does a single incremental update for all the edits,
+             * if any of them dirtied the scene.
+             * Transactions can be nested, only the outer commit() updates.
+             * In Pull mode commit() doesn't update, the dirty nodes are run when
+             * something evaluates a field that depends on them.
+             */
+            void begin_transaction();
+            status commit();
+            bool in_transaction();
+
             // Node
 
             unsigned int add_node(const unsigned int node, const std::string name); 
+            status add_nodes(const std::vector<FNodeSpec>& nodes, const std::vector<FConnectionSpec>& connections, std::vector<unsigned int>& uids);
             bool nodes_added(std::vector<unsigned int>& uids);
             void remove_node(const unsigned int uid, status& error);
             void nodes_updated();
@@ -58,7 +78,13 @@ namespace feather
             unsigned int get_node_id(const unsigned int uid, status& error);
             status get_node_connected_uids(int uid, std::vector<int>& uids);
             status get_node_connected_uids(int uid, int fid, std::vector<int>& uids);
+            status get_node_input_uids(int uid, std::vector<int>& uids);
+            // the connections in flat arrays, good until the next topology change
+            const GraphSnapshot& get_graph_snapshot();
             status get_node_draw_items(int nid, draw::DrawItems& items);
+            status set_node_cache(int uid, unsigned int size);
+            status get_node_cache_stats(int uid, unsigned int& hits, unsigned int& misses);
+            status evaluate_frames(int tuid, int tfid, FReal start, FReal end, FReal step, const std::vector<FFieldId>& outputs, std::vector<FFrame>& frames);
             status load_plugins();
             status run_command(std::string cmd, feather::parameter::ParameterList params);
             status run_command_string(std::string str);
@@ -71,6 +97,16 @@ namespace feather
             status get_layer(int id, FLayer &layer);
             void set_layer_name(std::string name, int lid);
             void set_layer_color(int r, int g, int b, int lid);
+            /*
+             * Events
+             * The field writes and topology changes since the last flush_events()
+             * go to the subscribers whose filter they match. The widgets flush
+             * once a frame.
+             */
+            unsigned int subscribe_events(const event::Filter& filter, event::Handler handler);
+            void unsubscribe_events(unsigned int id);
+            void flush_events();
+
             void set_layer_visible(bool v, int lid);
             void set_layer_locked(bool l, int lid);
             int layer_count();
@@ -98,11 +134,17 @@ namespace feather
             status get_field_val(int uid, int node, int field, int& val);
             status get_field_val(int uid, int node, int field, FReal& val);
             status get_field_val(int uid, int node, int field, FMesh& val);
+            // read the field value in place, the scene can't update while the view is held
+            status get_field_view(int uid, int node, int field, field::FieldView<FMesh>& view);
             // set the field value
             status set_field_val(int uid, int node, int field, bool& val);
             status set_field_val(int uid, int node, int field, int& val);
             status set_field_val(int uid, int node, int field, FReal& val);
 
+            // versions only go up, a value hasn't changed if it's version is the same as when it was read
+            uint64_t get_field_version(int uid, int fid);
+            uint64_t get_node_version(int uid);
+
             status get_field_connection_status(int uid, int field, bool& val);
             status get_field_connection_status(int uid, int node, int field, bool& val);
             status get_field_connection_status(int suid, int sfid, int tuid, int tfid, bool& val);
@@ -118,7 +160,12 @@ namespace feather
             void get_node_out_connections(const unsigned int uid, std::vector<unsigned int>& uids);
             int get_node_connection_count(int uid);
             void get_node_name(const unsigned int uid, std::string& name, status& error);
+            status set_node_name(const unsigned int uid, const std::string name);
             void scenegraph_update();
+            void set_thread_count(unsigned int threads);
+            unsigned int get_thread_count();
+            void set_update_schedule(state::SGSchedule schedule);
+            void set_evaluate_mode(state::SGEvaluate mode);
             int get_min_uid();
             int get_max_uid();
             void get_plugins(std::vector<PluginInfo>& list);
@@ -130,6 +177,7 @@ namespace feather
             status select_node(int type, int uid, int nid);
             status select_node(int type, int uid, int nid, int fid);
             status get_selected_nodes(std::vector<int>& uids);
+            bool node_selected(int uid);
             void clear_selection();
    
         } // namespace command
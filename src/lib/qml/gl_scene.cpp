@@ -45,6 +45,7 @@ glMesh::glMesh(feather::draw::Item* _item, Type _type)
     : glDrawItem(_item,glDrawItem::Mesh)
 {
     m_Fid=static_cast<feather::draw::Mesh*>(_item)->fid;
+    m_Version=0;
 }
 
 glMesh::~glMesh()
@@ -95,13 +96,17 @@ void glMesh::init()
 void glMesh::build()
 {
 
-    feather::FMesh mesh;
-    feather::qml::command::get_field_val(m_Uid,m_Nid,m_Fid,mesh);                
+    // the mesh is read where it's stored, the scene waits to update until the build is done
+    feather::field::FieldView<feather::FMesh> view;
+    if(feather::qml::command::get_field_view(m_Uid,m_Nid,m_Fid,view).state==feather::FAILED)
+        return;
+    const feather::FMesh& mesh = *view;
+    m_Version = feather::qml::command::get_field_version(m_Uid,m_Fid);
         
     uint id=0;                                                             
     int fcount=0; // this is a temp value to test selection                
     //std::for_each(mesh.f.begin(), mesh.f.end(), [this,&mesh,&id,&fcount,&m_aGlei,&m_aGli,&m_aGlc](feather::FFace _face){
-    std::for_each(mesh.f.begin(), mesh.f.end(), [this,&mesh,&id,&fcount](feather::FFace _face){
+    std::for_each(mesh.f.begin(), mesh.f.end(), [this,&mesh,&id,&fcount](const feather::FFace& _face){
 
         //for_each(_face.begin(),_face.end(),[&mesh,&m_aGlei](feather::FFacePoint _fp){ m_aGlei.push_back(_fp.v); });
        for_each(_face.begin(),_face.end(),[this,&mesh](feather::FFacePoint _fp){ m_aGlei.push_back(_fp.v); });
@@ -117,7 +122,6 @@ void glMesh::build()
                 m_aGlc.push_back(feather::FColorRGBA());
             }
             //std::cout << "v" << id << ":" << _face.at(id).v << ",";
-            std::cout << "v.y" << id << ":" << mesh.v.at(_face.at(id).v).y << ",";
             m_aV.push_back(mesh.v.at(_face.at(id).v));
             m_aVn.push_back(mesh.vn.at(_face.at(id).vn));
             //glvn.push_back(vn.at(_face.at(id).vn));
@@ -219,6 +223,16 @@ void glMesh::draw()
 
 void glMesh::update()
 {
+    // only rebuild if the mesh was written since the last build
+    if(feather::qml::command::get_field_version(m_Uid,m_Fid) == m_Version)
+        return;
+
+    m_aV.clear();
+    m_aVn.clear();
+    m_aGlei.clear();
+    m_aGli.clear();
+    m_aGlc.clear();
+    build();
 }
 
 
@@ -448,13 +462,13 @@ void glScene::addItems(unsigned int uid)
     
     m_apItems.clear();
     
-    for(auto item : items) {
+    for(auto& item : items) {
         item->uid=uid;
         item->nid=nid;
         switch(item->type){
             case feather::draw::Item::Mesh:
                 std::cout << "add Mesh\n";
-                m_apItems.push_back(new glMesh(item));
+                m_apItems.push_back(new glMesh(item.get()));
                 m_apItems.at(m_apItems.size()-1)->setProgram(m_pProgram);
                 m_apItems.at(m_apItems.size()-1)->setView(m_pView);
                 m_apItems.at(m_apItems.size()-1)->init();
@@ -473,6 +487,10 @@ void glScene::addItems(unsigned int uid)
         }
         //m_apItems.at(m_apItems.size()-1)->draw();
     }
+
+    // the gl items point to the items so they have to live as long as the scene
+    for(auto& item : items)
+        m_aItems.push_back(item);
 }
 
 void glScene::nodesRemovedInit()
@@ -107,6 +107,7 @@ namespace feather
  
             private:
                 unsigned int m_Fid;
+                uint64_t m_Version; // version of the mesh field when it was built
        };
 
         enum CameraType { Orthographic, Perspective };
@@ -161,6 +162,7 @@ namespace feather
                 //std::vector<glMesh*> m_apMeshes;
                 //std::vector<glLight*> m_apLights;
                 std::vector<glDrawItem*> m_apItems;
+                feather::draw::DrawItems m_aItems; // the items the gl items were made from
                 QMatrix4x4* m_pView;
                 QOpenGLShaderProgram* m_pProgram;
                 QOpenGLShaderProgram m_GridProgram;
@@ -30,10 +30,26 @@ using namespace feather;
 // SceneGraph
 SceneGraph::SceneGraph(QObject* parent)
 {
+    // one nodeFieldChanged for each field written since the last flush, however many times it was written
+    m_events = qml::command::subscribe_events(event::Filter(true,false),[this](const event::FieldEvents& fields, const event::TopologyEvents&){
+            status e;
+            for(const event::FieldEvent& f : fields)
+                emit nodeFieldChanged(f.uid,qml::command::get_node_id(f.uid,e),f.fid);
+            });
+
+    m_pEventTimer = new QTimer(this);
+    connect(m_pEventTimer,SIGNAL(timeout()),this,SLOT(flushEvents()));
+    m_pEventTimer->start(16);
 }
 
 SceneGraph::~SceneGraph()
 {
+    qml::command::unsubscribe_events(m_events);
+}
+
+void SceneGraph::flushEvents()
+{
+    qml::command::flush_events();
 }
 
 void SceneGraph::clear()
@@ -145,6 +161,25 @@ void SceneGraph::triggerUpdate()
     emit updateGraph();
 }
 
+void SceneGraph::begin_transaction()
+{
+    qml::command::begin_transaction();
+}
+
+int SceneGraph::commit()
+{
+    status p = qml::command::commit();
+    if(p.state==FAILED) {
+        std::cout << p.msg << std::endl;
+        return p.state;
+    }
+
+    // the widgets see all the transaction's edits at once
+    if(!qml::command::in_transaction())
+        emit updateGraph();
+    return p.state;
+}
+
 void SceneGraph::add_node_to_layer(int uid, int lid)
 {
     qml::command::add_node_to_layer(uid,lid);
@@ -168,7 +203,7 @@ QList<unsigned int> SceneGraph::connected_fields(unsigned int uid, unsigned int
 
 
 // Field
-Field::Field(QObject* parent): m_uid(0),m_node(0),m_field(0),m_boolVal(false),m_intVal(0),m_realVal(0.0),m_connected(false)
+Field::Field(QObject* parent): m_uid(0),m_node(0),m_field(0),m_boolVal(false),m_intVal(0),m_realVal(0.0),m_connected(false),m_version(0)
 {
 }
 
@@ -185,18 +220,34 @@ int Field::type()
 
 // GET FIELD VALUES
 
+void Field::refresh()
+{
+    // nothing to send if the write was already read
+    uint64_t version = qml::command::get_field_version(m_uid,m_field);
+    if(version == m_version)
+        return;
+    m_version = version;
+    emit boolValChanged();
+    emit intValChanged();
+    emit realValChanged();
+    emit connectedChanged();
+}
+
 void Field::get_bool_val()
 {
+    m_version = qml::command::get_field_version(m_uid,m_field);
     qml::command::get_field_val(m_uid,m_node,m_field,m_boolVal);
 }
 
 void Field::get_int_val()
 {
+    m_version = qml::command::get_field_version(m_uid,m_field);
     qml::command::get_field_val(m_uid,m_node,m_field,m_intVal);
 }
 
 void Field::get_real_val()
 {
+    m_version = qml::command::get_field_version(m_uid,m_field);
     qml::command::get_field_val(m_uid,m_node,m_field,m_realVal);
 }
 
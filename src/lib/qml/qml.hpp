@@ -78,6 +78,8 @@ class SceneGraph : public QObject
         Q_INVOKABLE void clear_selection();
         Q_INVOKABLE int run_command_string(QString str);
         Q_INVOKABLE void triggerUpdate();
+        Q_INVOKABLE void begin_transaction();
+        Q_INVOKABLE int commit();
         Q_INVOKABLE void add_node_to_layer(int uid, int lid);
         Q_INVOKABLE bool connected(unsigned int uid, unsigned int fid);
         Q_INVOKABLE QList<unsigned int> connected_fields(unsigned int uid, unsigned int fid);
@@ -95,7 +97,14 @@ class SceneGraph : public QObject
         void nodeRemoved(int uid);
         void nodesRemoved();
         void cleared();
-        void nodeFieldChanged(unsigned int uid, unsigned int nid, unsigned int fid);
+        void nodeFieldChanged(unsigned int uid, unsigned int nid, unsigned int fid); // sent once a frame for each field that was written
+
+    private slots:
+        void flushEvents();
+
+    private:
+        QTimer* m_pEventTimer; // flushes the scene's events once a frame
+        unsigned int m_events; // subscription that sends nodeFieldChanged
 };
 
 // FIELD 
@@ -183,6 +192,9 @@ class Field: public QObject
 
         bool connected() { get_connected(); return m_connected; };
 
+        // read the value from the scene again if it was written since the last read
+        Q_INVOKABLE void refresh();
+
         enum Type {
             Bool=field::Bool,
             Int=field::Int,
@@ -232,6 +244,7 @@ class Field: public QObject
         int m_intVal;
         FReal m_realVal;
         bool m_connected;
+        uint64_t m_version; // version of the field when the value was last read
 };
 
 
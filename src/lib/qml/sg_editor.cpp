@@ -185,7 +185,7 @@ SceneGraphNode::SceneGraphNode(int uid, int nid, QQuickItem* parent) :
 {
     feather::status e;
 
-    if(feather::smg::Instance()->selected(m_uid))
+    if(feather::qml::command::node_selected(m_uid))
         m_nodeFillBrush.setColor(QColor(SELECTED_NODE_COLOR));
     else
         m_nodeFillBrush.setColor(QColor(DESELECTED_NODE_COLOR));
@@ -274,12 +274,12 @@ void SceneGraphNode::paint(QPainter* painter)
     QPen textPen = QPen(QColor(NODE_TEXT_COLOR),2);
     QFont textFont("DejaVuSans",10);
 
-    if(feather::smg::Instance()->selected(m_uid))
+    if(feather::qml::command::node_selected(m_uid))
         m_nodeFillBrush.setColor(QColor(SELECTED_NODE_COLOR));
     else
         m_nodeFillBrush.setColor(QColor(DESELECTED_NODE_COLOR));
 
-    textFont.setBold((feather::smg::Instance()->selected(m_uid)) ? true : false);
+    textFont.setBold((feather::qml::command::node_selected(m_uid)) ? true : false);
 
     QBrush connInFillBrush = QBrush(QColor("#FF4500"));
     QBrush connOutFillBrush = QBrush(QColor("#DA70D6"));
@@ -348,7 +348,7 @@ void SceneGraphNode::hoverEnterEvent(QHoverEvent* event)
 
 void SceneGraphNode::hoverLeaveEvent(QHoverEvent* event)
 {
-    if(feather::smg::Instance()->selected(m_uid)){
+    if(feather::qml::command::node_selected(m_uid)){
         m_nodeFillBrush.setColor(QColor(SELECTED_NODE_COLOR));
     } else {
         m_nodeFillBrush.setColor(QColor(DESELECTED_NODE_COLOR));
@@ -663,15 +663,12 @@ void SceneGraphEditor::updateNode(SceneGraphNode* pnode, int uid, int xpos, int
         node->setX(xpos);
         node->setY(ypos);
 
-        // get the connected nodes
-        std::vector<int> cuids;
-        feather::qml::command::get_node_connected_uids(uid,cuids);
-
         // add a link for each connection between the two nodes
+        const feather::GraphSnapshot& graph = feather::qml::command::get_graph_snapshot();
         int ystep=0;
-        for(auto c : cuids) {
+        for(const feather::FSnapshotEdge& e : graph.out_edges(uid)) {
             // add the child node to draw list and get it's links
-            updateNode(node, c, xpos+200, ypos+ystep);
+            updateNode(node, e.uid, xpos+200, ypos+ystep);
             ystep+=node->height()+40;
         } 
 
@@ -694,44 +691,28 @@ void SceneGraphEditor::updateLinks(int uid)
     if(!pnode)
         return;
 
-    // get all the node's output connections
-    std::vector<int> uids;
-    feather::qml::command::get_node_connected_uids(uid,uids); 
-
-    // if there is no connected nodes, no need to go any further
-    if(!uids.size())
-        return;
-
-    // some of the connected uids are not shown in sg editor, so remove them from the list
-    std::vector<int> shownuids;
-
-    for(auto tuid : uids){
-        for(auto n : m_nodes){
-            if(n->uid()==tuid)
-                shownuids.push_back(tuid);
-        } 
-    }
-
-    // if none of the uids are displayed, no need to go any further
-    if(!shownuids.size())
-        return;
-
-    // for each node create a link for each connection
-    for(auto tuid : shownuids){
-        // go through each in field of the target uid
-        for(auto tconn : getNode(tuid)->inConnections()){
-
-            // go through each out field of the parent uid
-            for(auto sconn : pnode->outConnections()){
-                // is the field connected
-                bool connected=false;
-                feather::qml::command::get_field_connection_status(uid, sconn->fid(), tuid, tconn->fid(), connected);
-                if(connected){
-                    // add the link
-                    m_links.push_back(new SceneGraphLink(sconn,tconn,this));
-                }
-            }
+    // create a link for each connection to a node that's shown
+    const feather::GraphSnapshot& graph = feather::qml::command::get_graph_snapshot();
+    for(const feather::FSnapshotEdge& e : graph.out_edges(uid)){
+        // some of the connected uids are not shown in sg editor
+        SceneGraphNode* tnode = getNode(e.uid);
+        if(!tnode)
+            continue;
+
+        SceneGraphConnection* sconn = nullptr;
+        for(auto c : pnode->outConnections()){
+            if(c->fid()==e.sfid)
+                sconn = c;
+        }
+        SceneGraphConnection* tconn = nullptr;
+        for(auto c : tnode->inConnections()){
+            if(c->fid()==e.tfid)
+                tconn = c;
         }
+
+        // add the link
+        if(sconn && tconn)
+            m_links.push_back(new SceneGraphLink(sconn,tconn,this));
     }
 }
 
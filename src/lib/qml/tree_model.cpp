@@ -92,8 +92,9 @@ bool Leaf::removeChildren(int position, int count)
     if (position < 0 || position + count > m_childItems.size())
         return false;
 
-    for (int row = 0; row < count; ++row)
-        delete m_childItems.takeAt(position);
+    // take the rows out in one go, row by row is quadratic on a big scene
+    qDeleteAll(m_childItems.begin()+position, m_childItems.begin()+position+count);
+    m_childItems.erase(m_childItems.begin()+position, m_childItems.begin()+position+count);
 
     return true;
 }
@@ -352,12 +353,11 @@ void TreeModel::removeNode(int uid, const QModelIndex& parent)
 
 void TreeModel::clearTree()
 {
+    // every node goes in one remove so File->New doesn't scale with the scene
     QModelIndex parent = index(0,0);
-    QList<Leaf*> children = getLeaf(parent)->childItems();
-
-    std::for_each(children.begin(), children.end(), [this,&parent](Leaf* leaf){
-        removeRows(leaf->row(),1,parent);
-    });
+    const int count = getLeaf(parent)->childCount();
+    if(count)
+        removeRows(0,count,parent);
 }
 
 void TreeModel::loadChildren(const int uid, Leaf* parent)
@@ -380,15 +380,9 @@ void TreeModel::loadChildren(const int uid, Leaf* parent)
     parent->appendChild(new Leaf(data,parent)); 
 
     // recursive loop through each child node
-    std::vector<int> children;
     int fid = 2; // we only want to get the nodes for child field
-    feather::qml::command::get_node_connected_uids(uid,fid,children);
-   
-    if(!children.size())
-        return;
-
-    for_each(children.begin(), children.end(), [this,&parent](int uid){
-        loadChildren(uid,parent->lastChild());
-    });
+    const feather::GraphSnapshot& graph = feather::qml::command::get_graph_snapshot();
+    for(const feather::FSnapshotEdge& e : graph.out_edges(uid,fid))
+        loadChildren(e.uid,parent->lastChild());
 }
 
@@ -188,8 +188,11 @@ MeshGeometry::~MeshGeometry()
 
 void MeshGeometry::build()
 {
-    feather::FMesh mesh;
-    feather::qml::command::get_field_val(uid,nid,fid,mesh);
+    // the mesh is read where it's stored, the scene waits to update until the build is done
+    feather::field::FieldView<feather::FMesh> view;
+    if(feather::qml::command::get_field_view(uid,nid,fid,view).state==feather::FAILED)
+        return;
+    const feather::FMesh& mesh = *view;
 
     // build gl mesh from mesh
     feather::FIntArray glei;
@@ -198,7 +201,7 @@ void MeshGeometry::build()
     //feather::FVertex3DArray glv;
     uint id=0;
     int fcount=0; // this is a temp value to test selection
-    std::for_each(mesh.f.begin(), mesh.f.end(), [this,&mesh,&id,&fcount,&glei,&gli,&glc](feather::FFace _face){
+    std::for_each(mesh.f.begin(), mesh.f.end(), [this,&mesh,&id,&fcount,&glei,&gli,&glc](const feather::FFace& _face){
 
             for_each(_face.begin(),_face.end(),[&mesh,&glei](feather::FFacePoint _fp){ glei.push_back(_fp.v); });
             /*
@@ -1005,24 +1008,33 @@ void Viewport2::setShowAxis(const bool &show)
 
 void Viewport2::buildScene(feather::draw::DrawItems& items)
 {
-    for(auto item : items) {
+    for(auto& item : items) {
         switch(item->type){
             case feather::draw::Item::Mesh:
                 std::cout << "build Mesh\n";
-                m_apDrawItems.append(new Mesh(item,this));
+                m_apDrawItems.append(new Mesh(item.get(),this));
                 break;
             case feather::draw::Item::Line:
                 std::cout << "build Line\n";
-                m_apDrawItems.append(new Line(item,this));
+                m_apDrawItems.append(new Line(item.get(),this));
                 break;
             case feather::draw::Item::PerspCamera:
                 std::cout << "build Line\n";
-                m_apDrawItems.append(new PerspCamera(item,this));
+                m_apDrawItems.append(new PerspCamera(item.get(),this));
                 break;
             default:
                 std::cout << "nothing built\n";
         }
     }
+    keepItems(items);
+}
+
+void Viewport2::keepItems(feather::draw::DrawItems& items)
+{
+    // the DrawItems point to the items so they have to live as long as the viewport
+    for(auto& item : items)
+        m_aItems.push_back(item);
+    items.clear();
 }
 
 void Viewport2::onEntered()
@@ -1045,21 +1057,21 @@ void Viewport2::addItems(unsigned int uid)
 
     m_apDrawItems.clear();
 
-    for(auto item : items) {
+    for(auto& item : items) {
         item->uid=uid;
         item->nid=nid;
         switch(item->type){
             case feather::draw::Item::Mesh:
                 std::cout << "add Mesh\n";
-                m_apDrawItems.append(new Mesh(item,this));
+                m_apDrawItems.append(new Mesh(item.get(),this));
                 break;
             case feather::draw::Item::Line:
                 std::cout << "add Line\n";
-                m_apDrawItems.append(new Line(item,this));
+                m_apDrawItems.append(new Line(item.get(),this));
                 break;
             case feather::draw::Item::PerspCamera:
                 std::cout << "updating Perspective Camear draw item\n";
-                m_apDrawItems.append(new PerspCamera(item,this));
+                m_apDrawItems.append(new PerspCamera(item.get(),this));
                 break;
             default:
                 std::cout << "nothing built\n";
@@ -1067,6 +1079,7 @@ void Viewport2::addItems(unsigned int uid)
         m_apDrawItems.at(m_apDrawItems.size()-1)->updateItem();
     }
 
+    keepItems(items);
 
 }
 
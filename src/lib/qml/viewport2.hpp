@@ -358,9 +358,11 @@ class Viewport2 : public Qt3D::QEntity
     private:
         // use this method to see if there are any items that need to be built
         bool buildItems(feather::draw::DrawItems& items);
+        void keepItems(feather::draw::DrawItems& items);
         bool m_showGrid;
         bool m_showAxis;
         QList<DrawItem*> m_apDrawItems;
+        feather::draw::DrawItems m_aItems; // the items the DrawItems were made from
         Grid* m_pGrid;
         Axis* m_pAxis;
         Qt3D::QMouseController *m_pMouseController;
@@ -211,8 +211,8 @@ Rectangle {
                 case Field.Bool || Field.BoolArray: field.boolVal = (!field.boolVal) ? true : false ; break;
                 case Field.Int || Field.IntArray: field.intVal = field.intVal + 1; break;
                 //case Field.Float || Field.FloatArray: field.realVal = field.floatVal + 1 ; break;
-                //case Field.Double || Field.DoubleArray: field.realVal = field.realVal + 0.1; valueText.text = field.realVal.toFixed(2); SceneGraph.nodeFieldChanged(uId,nodeKey,fieldKey); break;
-                case Field.Real || Field.DoubleArray: field.realVal = field.realVal + 0.1; valueText.text = field.realVal.toFixed(2); SceneGraph.triggerUpdate(); SceneGraph.nodeFieldChanged(uId,nodeKey,fieldKey); break;
+                //case Field.Double || Field.DoubleArray: field.realVal = field.realVal + 0.1; valueText.text = field.realVal.toFixed(2); break;
+                case Field.Real || Field.DoubleArray: field.realVal = field.realVal + 0.1; valueText.text = field.realVal.toFixed(2); SceneGraph.triggerUpdate(); break;
                 case Field.Vertex || Field.VertexArray: ; break;
                 case Field.Vector || Field.VectorArray: ; break;
                 case Field.Mesh: ; break;
@@ -224,7 +224,20 @@ Rectangle {
         }
     }
 
-    Component.onCompleted: { intField.state="normal" }
+    // only this field's writes matter
+    function fieldChanged(uid,nid,fid) {
+        if(uid != uId || fid != fieldKey)
+            return
+        field.refresh()
+        valueText.text = (field.type == Field.Real) ? field.realVal.toFixed(2) : value
+    }
+
+    Component.onCompleted: {
+        intField.state="normal"
+        SceneGraph.nodeFieldChanged.connect(fieldChanged)
+    }
+
+    Component.onDestruction: { SceneGraph.nodeFieldChanged.disconnect(fieldChanged) }
 
     function typeNormalStateColor(t) {
         //switch(intField.fieldType) {
@@ -120,7 +120,10 @@ Rectangle {
     }
 
 
+    // only the time node's fields matter
     function updateFields(uid,nid,fid) {
+        if(uid != cpos.uid)
+            return
         stime.updateValue()
         etime.updateValue()
         slider.stime = stime.realValue
@@ -236,8 +236,9 @@ Rectangle {
         vp.updateItems(uid)
     }
 
+    // only the node whose field was written gets redrawn
     function updateViewport(uid,nid,fid) {
-        vp.doUpdate()
+        vp.updateItems(uid)
     }
 
     Component.onCompleted: {
@@ -0,0 +1,1011 @@
+/***********************************************************************
+ *
+ * Filename: scenetest.cpp
+ *
+ * Description: Automated tests of the scenegraph, run by ctest.
+ *
+ * Copyright (C) 2015 Richard Layman, rlayman2000@yahoo.com 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "deps.hpp"
+#include "scenegraph.hpp"
+#include "simd.hpp"
+#include "testplugin.hpp"
+
+using namespace feather;
+
+static int failures=0;
+
+#define CHECK(__cond)\
+    if(!(__cond)) {\
+        std::cerr << __FILE__ << ":" << __LINE__ << " failed: " << #__cond << std::endl;\
+        failures++;\
+    }
+
+
+// HELPERS
+
+// adds a node under the root, the root is uid 0
+unsigned int add_node(int nid, std::string name)
+{
+    status e;
+    unsigned int uid = scenegraph::add_node(nid,name,e);
+    scenegraph::connect(0,2,uid,1,false);
+    return uid;
+}
+
+template <typename _Type>
+_Type& value(unsigned int uid, int fid)
+{
+    return static_cast<field::Field<_Type>*>(scenegraph::get_node_fieldBase(uid,fid))->value;
+}
+
+template <typename _Type>
+_Type frame_value(const FFrame& frame, unsigned int i)
+{
+    return static_cast<field::Field<_Type>*>(frame.values.at(i).get())->value;
+}
+
+
+// FRAMES
+
+/*
+ * An ADD feeding a SCALE through an Int to Float conversion, with the
+ * time on the ADD's a. Each frame has to see it's own time all the way
+ * down and the scene keeps it's values.
+ */
+void test_frames()
+{
+    Scene s;
+    scenegraph::SceneScope scope(s);
+    status e;
+    scenegraph::add_node(TEST_ROOT,"root",e);
+    unsigned int a = add_node(TEST_ADD,"a");
+    unsigned int x = add_node(TEST_SCALE,"x");
+    CHECK(scenegraph::connect(a,5,x,3,false).state);
+    value<FInt>(a,4) = 1;
+    scenegraph::update();
+    CHECK(value<FFloat>(x,4) == 2.5f);
+
+    std::vector<FFieldId> outputs = {FFieldId(x,4),FFieldId(a,5)};
+    for(unsigned int threads : {0,3}) {
+        scenegraph::set_thread_count(threads);
+        std::vector<FFrame> frames;
+        CHECK(scenegraph::evaluate_frames(a,3,1,4,1,outputs,frames).state);
+        CHECK(frames.size() == 4);
+        for(const FFrame& frame : frames) {
+            CHECK(frame_value<FInt>(frame,1) == static_cast<int>(frame.time) + 1);
+            CHECK(frame_value<FFloat>(frame,0) == (frame.time + 1) * 2.5f);
+        }
+    }
+    CHECK(value<FInt>(a,3) == 0);
+    CHECK(value<FInt>(a,5) == 1);
+    CHECK(value<FFloat>(x,3) == 1.0f);
+    CHECK(value<FFloat>(x,4) == 2.5f);
+}
+
+// the time comes from the output of a node that isn't in the plan
+void test_frames_time_outside_plan()
+{
+    Scene s;
+    scenegraph::SceneScope scope(s);
+    status e;
+    scenegraph::add_node(TEST_ROOT,"root",e);
+    unsigned int t = scenegraph::add_node(TEST_ADD,"time",e);
+    unsigned int x = add_node(TEST_SCALE,"x");
+    CHECK(scenegraph::connect(t,5,x,3,false).state);
+
+    std::vector<FFrame> frames;
+    CHECK(scenegraph::evaluate_frames(t,5,2,6,2,{FFieldId(x,4)},frames).state);
+    CHECK(frames.size() == 3);
+    for(const FFrame& frame : frames)
+        CHECK(frame_value<FFloat>(frame,0) == frame.time * 2.5f);
+    CHECK(value<FInt>(t,5) == 0);
+}
+
+
+// the time is the output of a node in the plan, which must not overwrite it
+void test_frames_time_from_plan_node()
+{
+    Scene s;
+    scenegraph::SceneScope scope(s);
+    status e;
+    scenegraph::add_node(TEST_ROOT,"root",e);
+    unsigned int t = add_node(TEST_ADD,"time");
+    unsigned int x = add_node(TEST_SCALE,"x");
+    CHECK(scenegraph::connect(t,5,x,3,false).state);
+    value<FInt>(t,4) = 100;
+    scenegraph::update();
+    CHECK(value<FFloat>(x,4) == 250.0f);
+
+    std::vector<FFrame> frames;
+    CHECK(scenegraph::evaluate_frames(t,5,1,3,1,{FFieldId(x,4)},frames).state);
+    CHECK(frames.size() == 3);
+    for(const FFrame& frame : frames)
+        CHECK(frame_value<FFloat>(frame,0) == frame.time * 2.5f);
+    CHECK(value<FInt>(t,5) == 100);
+}
+
+// the frames are worked out while another thread reads the scene
+void test_frames_while_reading()
+{
+    Scene s;
+    scenegraph::SceneScope scope(s);
+    status e;
+    scenegraph::add_node(TEST_ROOT,"root",e);
+    unsigned int a = add_node(TEST_ADD,"a");
+    unsigned int x = add_node(TEST_SCALE,"x");
+    CHECK(scenegraph::connect(a,5,x,3,false).state);
+    scenegraph::set_thread_count(2);
+    scenegraph::update();
+
+    std::vector<FFrame> frames;
+    status baked(FAILED,"not done");
+    std::atomic<bool> done(false);
+    std::thread bake;
+    {
+        field::FieldView<FFloat> view = scenegraph::get_field_view<FFloat>(x,4);
+        CHECK(view);
+        bake = std::thread([&s,&frames,&baked,&done,a,x](){
+                scenegraph::SceneScope scope(s);
+                baked = scenegraph::evaluate_frames(a,3,0,99,1,{FFieldId(x,4)},frames);
+                done = true;
+                });
+        for(int i=0; i < 1000 && !done; i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        CHECK(done);
+    }
+    bake.join();
+    CHECK(baked.state);
+    CHECK(frames.size() == 100);
+    for(const FFrame& frame : frames)
+        CHECK(frame_value<FFloat>(frame,0) == frame.time * 2.5f);
+}
+
+
+// UPDATE
+
+// edits dirty the scene until the next update, reading it doesn't
+void test_needs_update()
+{
+    Scene s;
+    scenegraph::SceneScope scope(s);
+    status e;
+    scenegraph::add_node(TEST_ROOT,"root",e);
+    unsigned int a = add_node(TEST_ADD,"a");
+    unsigned int x = add_node(TEST_SCALE,"x");
+    CHECK(scenegraph::needs_update());
+    scenegraph::set_update_mode(state::Incremental);
+    scenegraph::update();
+    CHECK(!scenegraph::needs_update());
+
+    {
+        field::FieldView<FInt> sum = scenegraph::get_field_view<FInt>(a,5);
+        CHECK(sum && *sum == 0);
+    }
+    CHECK(!scenegraph::needs_update());
+
+    CHECK(scenegraph::set_field_value<FInt>(a,4,2).state);
+    CHECK(scenegraph::needs_update());
+    scenegraph::update();
+    CHECK(!scenegraph::needs_update());
+
+    CHECK(scenegraph::connect(a,5,x,3).state);
+    CHECK(scenegraph::needs_update());
+    scenegraph::update();
+    CHECK(!scenegraph::needs_update());
+    CHECK(value<FFloat>(x,4) == 5.0f);
+}
+
+
+// TOPOLOGICAL ORDER
+
+/*
+ * Edges are added to a TopoOrder in a random order. An edge is only
+ * rejected if it closes a path back to it's source and after each edge
+ * every node is still after the nodes feeding it.
+ */
+void test_topo_order()
+{
+    const unsigned int count = 200;
+    TopoOrder order;
+    for(unsigned int i=0; i < count; i++)
+        order.add_node();
+    std::vector<std::vector<unsigned int> > succ(count);
+    std::vector<std::vector<unsigned int> > pred(count);
+
+    // is there a path from a to b
+    auto reaches = [&succ](unsigned int a, unsigned int b){
+        std::vector<char> seen(succ.size(),0);
+        std::vector<unsigned int> stack(1,a);
+        while(!stack.empty()) {
+            unsigned int n = stack.back();
+            stack.pop_back();
+            if(n==b)
+                return true;
+            for(unsigned int s : succ[n]) {
+                if(!seen[s]) {
+                    seen[s] = 1;
+                    stack.push_back(s);
+                }
+            }
+        }
+        return false;
+    };
+
+    unsigned int seed=7, added=0, rejected=0;
+    for(int e=0; e < 1500; e++) {
+        seed = seed * 1103515245 + 12345;
+        const unsigned int x = (seed >> 8) % count;
+        seed = seed * 1103515245 + 12345;
+        const unsigned int y = (seed >> 8) % count;
+        const bool cycle = reaches(y,x);
+        const bool ok = order.add_edge(x,y,
+                [&succ](unsigned int n, std::vector<unsigned int>& list){ list.insert(list.end(),succ[n].begin(),succ[n].end()); },
+                [&pred](unsigned int n, std::vector<unsigned int>& list){ list.insert(list.end(),pred[n].begin(),pred[n].end()); });
+        CHECK(ok == !cycle);
+        if(!ok) {
+            rejected++;
+            continue;
+        }
+        added++;
+        succ[x].push_back(y);
+        pred[y].push_back(x);
+    }
+    CHECK(added > 100 && rejected > 100);
+
+    CHECK(order.size() == count);
+    for(unsigned int n=0; n < count; n++) {
+        CHECK(order.nodes()[order.position(n)] == n);
+        for(unsigned int s : succ[n])
+            CHECK(order.position(n) < order.position(s));
+    }
+}
+
+// the scenegraph turns down connections that would make a cycle
+void test_connect_cycle()
+{
+    Scene s;
+    scenegraph::SceneScope scope(s);
+    status e;
+    scenegraph::add_node(TEST_ROOT,"root",e);
+    unsigned int c = add_node(TEST_ADD,"c");
+    unsigned int b = add_node(TEST_ADD,"b");
+    unsigned int a = add_node(TEST_ADD,"a");
+    CHECK(scenegraph::connect(a,5,b,3,false).state);
+    CHECK(scenegraph::connect(b,5,c,3,false).state);
+    CHECK(scenegraph::connect(c,5,a,3,false).state == FAILED);
+    CHECK(scenegraph::connect(a,5,a,4,false).state == FAILED);
+    CHECK(!scenegraph::get_node_fieldBase(a,TEST_ADD,3)->connected);
+
+    // the plan runs the nodes in the connection order, not the order they were added
+    value<FInt>(a,4) = 2;
+    scenegraph::update();
+    CHECK(value<FInt>(c,5) == 2);
+    CHECK(s.eval_plan.position[a] < s.eval_plan.position[b]);
+    CHECK(s.eval_plan.position[b] < s.eval_plan.position[c]);
+
+    // once b is disconnected from c, c can feed a
+    CHECK(scenegraph::disconnect(b,5,c,3).state);
+    CHECK(scenegraph::connect(c,5,a,3,false).state);
+    scenegraph::update();
+    CHECK(s.eval_plan.position[c] < s.eval_plan.position[a]);
+}
+
+
+// NODE SLOTS
+
+/*
+ * Removing a node keeps the other uids and connections as they were.
+ * The freed slots are reused oldest first and a handle to a removed node
+ * stays stale after another node takes it's slot.
+ */
+void test_node_slots()
+{
+    Scene s;
+    scenegraph::SceneScope scope(s);
+    status e;
+    scenegraph::add_node(TEST_ROOT,"root",e);
+    unsigned int a = add_node(TEST_ADD,"a");
+    unsigned int b = add_node(TEST_ADD,"b");
+    unsigned int c = add_node(TEST_ADD,"c");
+    unsigned int x = add_node(TEST_SCALE,"x");
+    CHECK(scenegraph::connect(c,5,x,3,false).state);
+    FNodeHandle ha = scenegraph::get_node_handle(a);
+    FNodeHandle hb = scenegraph::get_node_handle(b);
+    CHECK(scenegraph::node_valid(ha) && scenegraph::node_valid(hb));
+
+    scenegraph::remove_node(b,e);
+    CHECK(e.state);
+    scenegraph::remove_node(a,e);
+    CHECK(e.state);
+    scenegraph::remove_node(a,e);
+    CHECK(e.state == FAILED);
+    CHECK(!scenegraph::node_exist(a) && !scenegraph::node_valid(ha));
+    CHECK(!scenegraph::node_exist(b) && !scenegraph::node_valid(hb));
+
+    // c and x kept their uids and connection
+    value<FInt>(c,3) = 4;
+    scenegraph::update();
+    CHECK(value<FFloat>(x,4) == 10.0f);
+
+    // b was freed first
+    unsigned int d = add_node(TEST_SCALE,"d");
+    unsigned int f = add_node(TEST_ADD,"f");
+    CHECK(d == b && f == a);
+    CHECK(!scenegraph::node_valid(hb) && !scenegraph::node_valid(ha));
+    CHECK(scenegraph::node_valid(scenegraph::get_node_handle(d)));
+    CHECK(value<FFloat>(d,3) == 0.0f && value<FInt>(f,5) == 0);
+    unsigned int named=0;
+    scenegraph::get_node_by_name("b",named);
+    CHECK(named == 0);
+
+    // no slot is free so the next node goes at the end
+    unsigned int g = add_node(TEST_ADD,"g");
+    CHECK(g == x+1);
+
+    // clearing only leaves the root, every other handle is stale
+    FNodeHandle hx = scenegraph::get_node_handle(x);
+    scenegraph::clear();
+    CHECK(!scenegraph::node_valid(hx) && !scenegraph::node_exist(x));
+    CHECK(scenegraph::node_exist(0));
+}
+
+
+// LEVELS
+
+/*
+ * 50 ADDs under the root each feeding a SCALE make three levels. Every
+ * schedule and thread count has to give the same values as a serial update.
+ */
+void test_levels()
+{
+    Scene s;
+    scenegraph::SceneScope scope(s);
+    status e;
+    scenegraph::add_node(TEST_ROOT,"root",e);
+    std::vector<unsigned int> adds;
+    std::vector<unsigned int> scales;
+    for(int i=0; i < 50; i++) {
+        adds.push_back(add_node(TEST_ADD,"a"+std::to_string(i)));
+        scales.push_back(add_node(TEST_SCALE,"x"+std::to_string(i)));
+        CHECK(scenegraph::connect(adds[i],5,scales[i],3,false).state);
+    }
+
+    scenegraph::set_schedule(state::Levels);
+    int round=0;
+    for(unsigned int threads : {0,1,3,7}) {
+        scenegraph::set_thread_count(threads);
+        round++;
+        for(int i=0; i < 50; i++) {
+            value<FInt>(adds[i],3) = i;
+            value<FInt>(adds[i],4) = round;
+        }
+        scenegraph::update();
+        CHECK(s.eval_plan.levels.size() == 4);
+        CHECK(s.eval_plan.levels[1] == 1 && s.eval_plan.levels[2] == 51);
+        for(int i=0; i < 50; i++) {
+            CHECK(value<FInt>(adds[i],5) == i + round);
+            CHECK(value<FFloat>(scales[i],4) == (i + round) * 2.5f);
+        }
+    }
+
+    // only the dirty nodes run, the others keep their values
+    scenegraph::set_update_mode(state::Incremental);
+    value<FFloat>(scales[1],4) = 0;
+    CHECK(scenegraph::set_field_value<FInt>(adds[0],3,10).state);
+    scenegraph::update();
+    CHECK(value<FFloat>(scales[0],4) == (10 + round) * 2.5f);
+    CHECK(value<FFloat>(scales[1],4) == 0);
+}
+
+
+// TIME
+
+// a Time output connected to a Time input passes it's value along
+void test_time_connection()
+{
+    Scene s;
+    scenegraph::SceneScope scope(s);
+    status e;
+    scenegraph::add_node(TEST_ROOT,"root",e);
+    unsigned int t1 = add_node(TEST_TIME,"t1");
+    unsigned int t2 = add_node(TEST_TIME,"t2");
+    unsigned int x = add_node(TEST_SCALE,"x");
+    CHECK(scenegraph::connect(t1,4,t2,3,false).state);
+    CHECK(scenegraph::connect(t1,4,x,3,false).state == FAILED);
+
+    FTime t;
+    t.time = 10;
+    t.fps = 24;
+    CHECK(scenegraph::set_field_value<FTime>(t1,3,t).state);
+    scenegraph::update();
+    CHECK(value<FTime>(t2,3).time == 20 && value<FTime>(t2,3).fps == 24);
+    CHECK(value<FTime>(t2,4).time == 40 && value<FTime>(t2,4).fps == 24);
+    {
+        field::FieldView<FTime> in = scenegraph::get_field_view<FTime>(t2,3);
+        CHECK(in && in->time == 20);
+    }
+
+    // a cached node hits on the time it has seen
+    scenegraph::set_node_cache(t2,2);
+    for(double time : {1.0,2.0,1.0}) {
+        t.time = time;
+        CHECK(scenegraph::set_field_value<FTime>(t1,3,t).state);
+        scenegraph::update();
+        CHECK(value<FTime>(t2,4).time == time * 4);
+    }
+    unsigned int hits=0, misses=0;
+    CHECK(scenegraph::get_node_cache_stats(t2,hits,misses).state);
+    CHECK(hits == 1 && misses == 2);
+}
+
+
+// CACHE
+
+/*
+ * Scalar inputs are keyed on their value, connected or not, so x hits
+ * when a gives it a value it has seen before, even if a ran again.
+ */
+void test_cache()
+{
+    Scene s;
+    scenegraph::SceneScope scope(s);
+    status e;
+    scenegraph::add_node(TEST_ROOT,"root",e);
+    unsigned int a = add_node(TEST_ADD,"a");
+    unsigned int x = add_node(TEST_SCALE,"x");
+    CHECK(scenegraph::connect(a,5,x,3,false).state);
+    scenegraph::set_node_cache(a,4);
+    scenegraph::set_node_cache(x,4);
+    unsigned int hits=0, misses=0;
+
+    for(int v : {1,2,1}) {
+        CHECK(scenegraph::set_field_value<FInt>(a,3,v).state);
+        scenegraph::update();
+        CHECK(value<FFloat>(x,4) == v * 2.5f);
+    }
+    CHECK(scenegraph::get_node_cache_stats(a,hits,misses).state);
+    CHECK(hits == 1 && misses == 2);
+    CHECK(scenegraph::get_node_cache_stats(x,hits,misses).state);
+    CHECK(hits == 1 && misses == 2);
+
+    // a doesn't run and x's input is the same
+    scenegraph::set_update_mode(state::Incremental);
+    scenegraph::mark_dirty(x);
+    value<FFloat>(x,4) = 0;
+    scenegraph::update();
+    CHECK(value<FFloat>(x,4) == 2.5f);
+    CHECK(scenegraph::get_node_cache_stats(a,hits,misses).state);
+    CHECK(hits == 1 && misses == 2);
+    CHECK(scenegraph::get_node_cache_stats(x,hits,misses).state);
+    CHECK(hits == 2 && misses == 2);
+
+    // a new value upstream is a miss
+    CHECK(scenegraph::set_field_value<FInt>(a,4,5).state);
+    scenegraph::update();
+    CHECK(value<FFloat>(x,4) == 15.0f);
+    CHECK(scenegraph::get_node_cache_stats(x,hits,misses).state);
+    CHECK(hits == 2 && misses == 3);
+
+    CHECK(scenegraph::get_node_cache_stats(0,hits,misses).state == FAILED);
+    CHECK(scenegraph::set_node_cache(1000,4).state == FAILED);
+    CHECK(scenegraph::set_node_cache(-1,4).state == FAILED);
+    CHECK(scenegraph::get_node_cache_stats(1000,hits,misses).state == FAILED);
+    scenegraph::remove_node(x,e);
+    CHECK(scenegraph::set_node_cache(x,4).state == FAILED);
+    CHECK(scenegraph::get_node_cache_stats(x,hits,misses).state == FAILED);
+}
+
+
+// SCHEDULER
+
+/*
+ * Runs a graph of tasks, task i feeds the tasks in feeds[i], and checks
+ * each task ran once and only after every task feeding it was done.
+ */
+void check_schedule(ThreadPool& pool, const std::vector<std::vector<unsigned int> >& feeds)
+{
+    const unsigned int count = feeds.size();
+    std::vector<unsigned int> indegree(count,0);
+    std::vector<unsigned int> offsets(1,0);
+    std::vector<unsigned int> succ;
+    for(unsigned int i=0; i < count; i++) {
+        for(unsigned int s : feeds[i]) {
+            succ.push_back(s);
+            indegree[s]++;
+        }
+        offsets.push_back(succ.size());
+    }
+
+    std::unique_ptr<std::atomic<unsigned int>[]> runs(new std::atomic<unsigned int>[count]);
+    for(unsigned int i=0; i < count; i++)
+        runs[i] = 0;
+    std::vector<unsigned int> start(count,0);
+    std::vector<unsigned int> end(count,0);
+    std::atomic<unsigned int> clock(0);
+    TaskScheduler(pool).run(indegree,offsets,succ,[&](unsigned int t){
+            runs[t]++;
+            start[t] = clock++;
+            end[t] = clock++;
+            });
+
+    for(unsigned int i=0; i < count; i++) {
+        CHECK(runs[i] == 1);
+        for(unsigned int s : feeds[i])
+            CHECK(end[i] < start[s]);
+    }
+}
+
+void test_scheduler()
+{
+    std::vector<std::vector<unsigned int> > chain(50);
+    for(unsigned int i=0; i+1 < chain.size(); i++)
+        chain[i].push_back(i+1);
+
+    // one task feeding 100 that all feed the last one
+    std::vector<std::vector<unsigned int> > fan(102);
+    for(unsigned int i=1; i <= 100; i++) {
+        fan[0].push_back(i);
+        fan[i].push_back(101);
+    }
+
+    // tasks feeding a few of the next 20
+    std::vector<std::vector<unsigned int> > mesh(300);
+    for(unsigned int i=0; i < mesh.size(); i++) {
+        for(unsigned int j=i+1; j < mesh.size() && j <= i+20; j++) {
+            if((i*31+j*17)%5 == 0)
+                mesh[i].push_back(j);
+        }
+    }
+
+    for(unsigned int threads : {0,1,3,7}) {
+        ThreadPool pool(threads);
+        check_schedule(pool,{});
+        check_schedule(pool,{{}});
+        for(int r=0; r < 20; r++) {
+            check_schedule(pool,chain);
+            check_schedule(pool,fan);
+            check_schedule(pool,mesh);
+        }
+    }
+}
+
+// the workers made by a resize only take the jobs that come after them
+void test_pool_resize()
+{
+    ThreadPool pool(1);
+    for(unsigned int threads : {1,3,2,7,0,4}) {
+        pool.resize(threads);
+        CHECK(pool.size() == threads);
+        // the new workers are waiting before the next job comes
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        for(int r=0; r < 5; r++) {
+            std::atomic<unsigned int> sum(0);
+            pool.run(100,[&sum](unsigned int i){ sum += i; });
+            CHECK(sum == 4950);
+        }
+    }
+}
+
+// threads with nothing to do sleep instead of spinning while a long task runs
+void test_scheduler_idle()
+{
+    ThreadPool pool(4);
+    std::vector<unsigned int> indegree = {0,1,1,1};
+    std::vector<unsigned int> offsets = {0,1,2,3,3};
+    std::vector<unsigned int> succ = {1,2,3};
+    const std::clock_t cpu = std::clock();
+    const auto wall = std::chrono::steady_clock::now();
+    TaskScheduler(pool).run(indegree,offsets,succ,[](unsigned int t){
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            });
+    const double cpu_ms = 1000.0 * (std::clock() - cpu) / CLOCKS_PER_SEC;
+    const double wall_ms = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - wall).count();
+    CHECK(wall_ms >= 200);
+    CHECK(cpu_ms < wall_ms / 2);
+}
+
+
+// EVENTS
+
+// what a subscriber got from it's flushes
+struct Received
+{
+    Received() : calls(0) {};
+    int calls;
+    event::FieldEvents fields;
+    event::TopologyEvents topology;
+};
+
+unsigned int receive(event::EventBus& bus, const event::Filter& filter, Received& r)
+{
+    return bus.subscribe(filter,[&r](const event::FieldEvents& f, const event::TopologyEvents& t){
+            r.calls++;
+            r.fields.insert(r.fields.end(),f.begin(),f.end());
+            r.topology.insert(r.topology.end(),t.begin(),t.end());
+            });
+}
+
+/*
+ * Field writes in a frame collapse to the latest version. Topology changes
+ * keep their order and only a repeat of the node's last change is dropped.
+ */
+void test_events_coalesce()
+{
+    event::EventBus bus;
+    bus.field_changed(1,2,1);
+    bus.topology_changed(1,event::NodeAdded);
+    CHECK(!bus.listening());
+    CHECK(!bus.pending());
+
+    Received all;
+    Received one;
+    unsigned int id = receive(bus,event::Filter(),all);
+    receive(bus,event::Filter(true,true,2),one);
+    CHECK(bus.listening());
+
+    bus.field_changed(1,2,3);
+    bus.field_changed(1,2,5);
+    bus.field_changed(1,2,4);
+    bus.field_changed(2,3,6);
+    bus.topology_changed(1,event::NodeAdded);
+    bus.topology_changed(1,event::NodeRemoved);
+    bus.topology_changed(1,event::NodeAdded);
+    bus.topology_changed(2,event::Connected);
+    bus.topology_changed(1,event::Connected);
+    bus.topology_changed(2,event::Connected);
+    bus.flush();
+
+    CHECK(all.calls == 1);
+    CHECK(all.fields.size() == 2);
+    CHECK(all.fields[0].uid == 1 && all.fields[0].version == 5);
+    CHECK(all.fields[1].uid == 2 && all.fields[1].version == 6);
+    std::vector<event::Kind> kinds;
+    for(const event::TopologyEvent& e : all.topology)
+        kinds.push_back(e.kind);
+    CHECK(kinds == std::vector<event::Kind>({event::NodeAdded,event::NodeRemoved,event::NodeAdded,event::Connected,event::Connected}));
+    CHECK(one.calls == 1);
+    CHECK(one.fields.size() == 1 && one.topology.size() == 1);
+
+    // a flush with nothing queued doesn't call anyone
+    bus.flush();
+    CHECK(all.calls == 1);
+
+    // the same change after a flush is a new event
+    bus.topology_changed(1,event::NodeAdded);
+    bus.topology_changed(2,event::NodeRemoved);
+    bus.topology_changed(0,event::Cleared);
+    bus.flush();
+    CHECK(all.calls == 2);
+    CHECK(all.topology.size() == 6 && all.topology.back().kind == event::Cleared);
+    CHECK(one.calls == 2);
+
+    bus.unsubscribe(id);
+    bus.field_changed(1,2,7);
+    bus.flush();
+    CHECK(all.calls == 2);
+    CHECK(one.calls == 2);
+}
+
+// writes through the scene come out once per field with the last version
+void test_events_scene()
+{
+    Scene s;
+    scenegraph::SceneScope scope(s);
+    status e;
+    scenegraph::add_node(TEST_ROOT,"root",e);
+    unsigned int a = add_node(TEST_ADD,"a");
+    Received r;
+    receive(scenegraph::events(),event::Filter(true,false),r);
+
+    CHECK(scenegraph::set_field_value<FInt>(a,3,1).state);
+    CHECK(scenegraph::set_field_value<FInt>(a,3,2).state);
+    CHECK(scenegraph::set_field_value<FFloat>(a,3,2).state == FAILED);
+    scenegraph::events().flush();
+    CHECK(r.calls == 1);
+    CHECK(r.fields.size() == 1);
+    CHECK(r.fields[0].uid == a && r.fields[0].fid == 3);
+    CHECK(r.fields[0].version == scenegraph::get_field_version(a,3));
+    CHECK(value<FInt>(a,3) == 2);
+}
+
+
+// FIELD SLOTS
+
+// the slot table made when the plugin was loaded finds every field of a node
+void test_field_slots()
+{
+    Scene s;
+    scenegraph::SceneScope scope(s);
+    status e;
+    scenegraph::add_node(TEST_ROOT,"root",e);
+    unsigned int a = add_node(TEST_ADD,"a");
+    unsigned int b = add_node(TEST_ADD,"b");
+    for(int fid=1; fid <= 5; fid++) {
+        field::FieldBase* f = scenegraph::get_fieldBase(b,fid);
+        CHECK(f && f->id == fid);
+        CHECK(f != scenegraph::get_fieldBase(a,fid));
+    }
+    CHECK(!scenegraph::get_fieldBase(a,6));
+    CHECK(!scenegraph::get_fieldBase(a,MAX_FIELD_ID+1));
+    CHECK(!scenegraph::get_fieldBase(0,3));
+}
+
+
+// COPY ON WRITE
+
+// copies share the buffer until one of them is changed
+void test_shared_array()
+{
+    const FSharedArray<FInt> none;
+    CHECK(none.size() == 0 && none.begin() == none.end());
+
+    FSharedArray<FInt> a;
+    for(int i=0; i < 5; i++)
+        a.push_back(i);
+    FSharedArray<FInt> b = a;
+    const FSharedArray<FInt>& cb = b;
+    CHECK(a.shared() && b.shared());
+    CHECK(cb.data() == a.data());
+    CHECK(cb[4] == 4);
+    CHECK(std::accumulate(cb.begin(),cb.end(),0) == 10);
+    CHECK(std::accumulate(b.cbegin(),b.cend(),0) == 10);
+    CHECK(b.shared());
+
+    // writing through [] or the iterators detaches only the written copy
+    b[0] = 10;
+    CHECK(!a.shared() && !b.shared());
+    CHECK(a[0] == 0 && b[0] == 10);
+    FSharedArray<FInt> c = a;
+    for(FInt& i : c)
+        i *= 2;
+    CHECK(a.read().at(4) == 4 && c.read().at(4) == 8);
+    CHECK(a.data() != c.data());
+
+    // a copy that isn't shared is written where it is
+    const FInt* buffer = b.data();
+    b.write()[1] = 11;
+    CHECK(b.data() == buffer);
+    b.clear();
+    CHECK(b.empty() && c.size() == 5);
+}
+
+// a mesh copied between fields keeps one set of arrays until it's changed
+void test_shared_mesh()
+{
+    FMesh m;
+    m.v.push_back(FVertex3D(0,0,0));
+    m.v.push_back(FVertex3D(1,0,0));
+    m.v.push_back(FVertex3D(1,1,0));
+    m.v.push_back(FVertex3D(0,1,0));
+    FFace face;
+    for(unsigned int i=0; i < 4; i++)
+        face.push_back(FFacePoint(i));
+    m.add_face(face);
+
+    field::Field<FMesh> from;
+    field::Field<FMesh> to;
+    from.value = m;
+    field::converter(field::Mesh,field::Mesh)(&from,&to);
+    CHECK(to.value.v.data() == m.v.data());
+    CHECK(to.value.f.data() == m.f.data());
+
+    CHECK(to.value.split_face(0,0,2));
+    CHECK(to.value.f.size() == 2);
+    CHECK(m.f.size() == 1 && from.value.f.size() == 1);
+    CHECK(to.value.v.data() == m.v.data());
+}
+
+
+// SIMD
+
+// a few numbers that go up and down so the min and max can be anywhere
+template <typename _Type>
+void fill(FAlignedArray<_Type>& a, unsigned int seed)
+{
+    for(unsigned int i=0; i < a.size(); i++)
+        a[i] = static_cast<_Type>(static_cast<int>((i*seed+3)%17) - 8);
+}
+
+/*
+ * The kernels against plain loops for every length up to a few registers,
+ * so each length of tail is run, with the arrays on a register boundary
+ * and one number off it.
+ */
+template <typename _Type>
+void check_kernels()
+{
+    for(unsigned int offset=0; offset < 2; offset++) {
+        for(std::size_t n=0; n <= 40; n++) {
+            FAlignedArray<_Type> a(n+1);
+            FAlignedArray<_Type> b(n+1);
+            FAlignedArray<_Type> out(n+1);
+            fill(a,7);
+            fill(b,5);
+            const _Type* pa = a.data()+offset;
+            const _Type* pb = b.data()+offset;
+            _Type* po = out.data()+offset;
+            CHECK(simd::aligned(a.data()));
+
+            simd::add(pa,pb,po,n);
+            for(std::size_t i=0; i < n; i++)
+                CHECK(po[i] == pa[i] + pb[i]);
+            simd::scale(pa,static_cast<_Type>(3),po,n);
+            for(std::size_t i=0; i < n; i++)
+                CHECK(po[i] == pa[i] * static_cast<_Type>(3));
+
+            // in place
+            FAlignedArray<_Type> c = a;
+            simd::add(c.data()+offset,pb,c.data()+offset,n);
+            for(std::size_t i=0; i < n; i++)
+                CHECK(c[i+offset] == pa[i] + pb[i]);
+
+            for(unsigned int items : {1u,3u,4u}) {
+                if(n % items)
+                    continue;
+                const std::size_t count = n/items;
+                _Type lo[4];
+                _Type hi[4];
+                simd::reduce<false>(pa,count,items,lo);
+                simd::reduce<true>(pa,count,items,hi);
+                for(unsigned int j=0; j < items && count; j++) {
+                    _Type rlo = pa[j];
+                    _Type rhi = pa[j];
+                    for(std::size_t i=j; i < n; i+=items) {
+                        rlo = std::min(rlo,pa[i]);
+                        rhi = std::max(rhi,pa[i]);
+                    }
+                    CHECK(lo[j] == rlo);
+                    CHECK(hi[j] == rhi);
+                }
+            }
+        }
+    }
+}
+
+template <typename _Type>
+void check_lerp()
+{
+    for(std::size_t n=0; n <= 40; n++) {
+        FAlignedArray<_Type> a(n);
+        FAlignedArray<_Type> b(n);
+        FAlignedArray<_Type> out(n);
+        fill(a,7);
+        fill(b,5);
+        const _Type t = static_cast<_Type>(0.25);
+        simd::lerp(a.data(),b.data(),t,out.data(),n);
+        for(std::size_t i=0; i < n; i++)
+            CHECK(out[i] == a[i] + (b[i] - a[i]) * t);
+    }
+}
+
+void test_simd_kernels()
+{
+    check_kernels<FInt>();
+    check_kernels<FFloat>();
+    check_kernels<FDouble>();
+    check_lerp<FFloat>();
+    check_lerp<FDouble>();
+
+    // the bounding box of vertices goes through the 3 number stride
+    FVertex3DArray v;
+    for(int i=0; i < 11; i++)
+        v.push_back(FVertex3D(i%4,-i,(i*5)%7));
+    FVertex3D lo;
+    FVertex3D hi;
+    CHECK(simd::min(v,lo) && simd::max(v,hi));
+    CHECK(lo.x == 0 && lo.y == -10 && lo.z == 0);
+    CHECK(hi.x == 3 && hi.y == 0 && hi.z == 6);
+    CHECK(!simd::min(FVertex3DArray(),lo));
+}
+
+// every bool has it's own byte and converts to ints
+void test_bool_array()
+{
+    field::Field<FBoolArray> from;
+    field::Field<FIntArray> to;
+    from.value.push_back(true);
+    from.value.push_back(false);
+    from.value.push_back(true);
+    from.value[1] = true;
+    CHECK(from.value[0] && from.value[1]);
+    CHECK(&from.value[1] == from.value.data()+1);
+    from.value[2] = false;
+    field::converter(field::BoolArray,field::IntArray)(&from,&to);
+    CHECK(to.value.size() == 3 && to.value[0] == 1 && to.value[1] == 1 && to.value[2] == 0);
+}
+
+struct alignas(64) WideItem
+{
+    char bytes[64];
+};
+
+// the arena gives the alignment that's asked for, even above it's block's own
+void test_arena_alignment()
+{
+    Arena arena(256);
+    for(std::size_t align : {1,8,16,32,64,128}) {
+        for(std::size_t size=1; size < 200; size+=37) {
+            void* p = arena.allocate(size,align);
+            CHECK(reinterpret_cast<std::uintptr_t>(p) % align == 0);
+        }
+    }
+    for(int i=0; i < 10; i++) {
+        arena.allocate(3,1);
+        CHECK(reinterpret_cast<std::uintptr_t>(arena.make<WideItem>()) % 64 == 0);
+    }
+    arena.reset();
+    arena.allocate(5,1);
+    CHECK(reinterpret_cast<std::uintptr_t>(arena.allocate(32,32)) % 32 == 0);
+}
+
+
+struct Test
+{
+    std::string name;
+    void (*run)();
+};
+
+int main(int argc, char** argv)
+{
+    scenegraph::load_plugins(TEST_PLUGIN_PATH);
+
+    std::vector<Test> tests = {
+        {"frames",test_frames},
+        {"frames_time_outside_plan",test_frames_time_outside_plan},
+        {"frames_time_from_plan_node",test_frames_time_from_plan_node},
+        {"frames_while_reading",test_frames_while_reading},
+        {"needs_update",test_needs_update},
+        {"topo_order",test_topo_order},
+        {"connect_cycle",test_connect_cycle},
+        {"node_slots",test_node_slots},
+        {"levels",test_levels},
+        {"time_connection",test_time_connection},
+        {"cache",test_cache},
+        {"scheduler",test_scheduler},
+        {"pool_resize",test_pool_resize},
+        {"scheduler_idle",test_scheduler_idle},
+        {"events_coalesce",test_events_coalesce},
+        {"events_scene",test_events_scene},
+        {"field_slots",test_field_slots},
+        {"shared_array",test_shared_array},
+        {"shared_mesh",test_shared_mesh},
+        {"simd_kernels",test_simd_kernels},
+        {"bool_array",test_bool_array},
+        {"arena_alignment",test_arena_alignment}
+    };
+
+    // with no argument every test is run
+    bool found=false;
+    for(const Test& test : tests) {
+        if(argc > 1 && test.name != argv[1])
+            continue;
+        found=true;
+        std::cout << "TEST " << test.name << std::endl;
+        test.run();
+    }
+
+    if(!found) {
+        std::cerr << "no test named " << argv[1] << std::endl;
+        return 1;
+    }
+
+    if(failures)
+        std::cerr << failures << " checks failed\n";
+    return (failures) ? 1 : 0;
+}
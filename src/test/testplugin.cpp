@@ -0,0 +1,149 @@
+/***********************************************************************
+ *
+ * Filename: testplugin.cpp
+ *
+ * Description: Small nodes used by the scenegraph tests.
+ *
+ * Copyright (C) 2015 Richard Layman, rlayman2000@yahoo.com 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "deps.hpp"
+#include "pluginmanager.hpp"
+#include "field.hpp"
+#include "node.hpp"
+#include "parameter.hpp"
+#include "command.hpp"
+#include "testplugin.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    C_PLUGIN_WRAPPER()
+#ifdef __cplusplus
+}
+#endif
+
+using namespace feather;
+
+
+// ROOT
+
+// parent
+ADD_FIELD_TO_NODE(TEST_ROOT,FNode,field::Node,field::connection::In,FNode(),1)
+// child
+ADD_FIELD_TO_NODE(TEST_ROOT,FNode,field::Node,field::connection::Out,FNode(),2)
+
+namespace feather
+{
+    DO_IT(TEST_ROOT)
+    {
+        return status();
+    };
+
+} // namespace feather
+
+NODE_INIT(TEST_ROOT,node::Empty,"")
+
+
+// ADD
+// sum = a + b
+
+// parent
+ADD_FIELD_TO_NODE(TEST_ADD,FNode,field::Node,field::connection::In,FNode(),1)
+// child
+ADD_FIELD_TO_NODE(TEST_ADD,FNode,field::Node,field::connection::Out,FNode(),2)
+// a
+ADD_FIELD_TO_NODE(TEST_ADD,FInt,field::Int,field::connection::In,0,3)
+// b
+ADD_FIELD_TO_NODE(TEST_ADD,FInt,field::Int,field::connection::In,0,4)
+// sum
+ADD_FIELD_TO_NODE(TEST_ADD,FInt,field::Int,field::connection::Out,0,5)
+
+namespace feather
+{
+    DO_IT(TEST_ADD)
+    {
+        FieldHandle<TEST_ADD,3,FInt> a(fields);
+        FieldHandle<TEST_ADD,4,FInt> b(fields);
+        FieldHandle<TEST_ADD,5,FInt> sum(fields);
+        sum.value() = a.value() + b.value();
+        return status();
+    };
+
+} // namespace feather
+
+NODE_INIT(TEST_ADD,node::Object,"")
+
+
+// SCALE
+// y = x * 2.5
+
+// parent
+ADD_FIELD_TO_NODE(TEST_SCALE,FNode,field::Node,field::connection::In,FNode(),1)
+// child
+ADD_FIELD_TO_NODE(TEST_SCALE,FNode,field::Node,field::connection::Out,FNode(),2)
+// x
+ADD_FIELD_TO_NODE(TEST_SCALE,FFloat,field::Float,field::connection::In,0,3)
+// y
+ADD_FIELD_TO_NODE(TEST_SCALE,FFloat,field::Float,field::connection::Out,0,4)
+
+namespace feather
+{
+    DO_IT(TEST_SCALE)
+    {
+        FieldHandle<TEST_SCALE,3,FFloat> x(fields);
+        FieldHandle<TEST_SCALE,4,FFloat> y(fields);
+        y.value() = x.value() * 2.5;
+        return status();
+    };
+
+} // namespace feather
+
+NODE_INIT(TEST_SCALE,node::Object,"")
+
+
+// TIME
+// out = in at twice the time
+
+// parent
+ADD_FIELD_TO_NODE(TEST_TIME,FNode,field::Node,field::connection::In,FNode(),1)
+// child
+ADD_FIELD_TO_NODE(TEST_TIME,FNode,field::Node,field::connection::Out,FNode(),2)
+// in
+ADD_FIELD_TO_NODE(TEST_TIME,FTime,field::Time,field::connection::In,FTime(),3)
+// out
+ADD_FIELD_TO_NODE(TEST_TIME,FTime,field::Time,field::connection::Out,FTime(),4)
+
+namespace feather
+{
+    DO_IT(TEST_TIME)
+    {
+        FieldHandle<TEST_TIME,3,FTime> in(fields);
+        FieldHandle<TEST_TIME,4,FTime> out(fields);
+        out.value().time = in.value().time * 2;
+        out.value().fps = in.value().fps;
+        return status();
+    };
+
+} // namespace feather
+
+NODE_INIT(TEST_TIME,node::Empty,"")
+
+
+PLUGIN_INIT("Test","Nodes for the scenegraph tests","Richard Layman",TEST_ROOT,TEST_TIME)
+
+feather::status parameter_type(std::string cmd, int key, feather::parameter::Type& type) { return feather::status(); }
@@ -0,0 +1,32 @@
+/***********************************************************************
+ *
+ * Filename: testplugin.hpp
+ *
+ * Description: Ids of the nodes in the test plugin.
+ *
+ * Copyright (C) 2015 Richard Layman, rlayman2000@yahoo.com 
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef TESTPLUGIN_HPP
+#define TESTPLUGIN_HPP
+
+#define TEST_ROOT 1 // fields 1 parent, 2 child
+#define TEST_ADD 2 // Int fields 3 a, 4 b in and 5 sum out
+#define TEST_SCALE 3 // Float fields 3 x in and 4 y out, y = x * 2.5
+#define TEST_TIME 4 // Time fields 3 in and 4 out, out is in at twice the time
+
+#endif